@@ -41,6 +41,9 @@
 
 */
 
+#include "layout_copy.c"
+#include "triangular.c"
+#include "trmm_alloc.c"
 #include "utils.c"
 #include <immintrin.h>
 #include <mpi.h>
@@ -85,15 +88,15 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 	  column stride (cs) is the step size going down the column.
 	*/
 	// A is column major
-	int rs_A = m0;
+	int rs_A = trmm_padded_ld(m0);
 	int cs_A = 1;
 
 	// B is column major
-	int rs_B = m0;
+	int rs_B = trmm_padded_ld(m0);
 	int cs_B = 1;
 
 	// C is column major
-	int rs_C = m0;
+	int rs_C = trmm_padded_ld(m0);
 	int cs_C = 1;
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
@@ -101,6 +104,9 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 
 	const int block_size = 8;
 
+	// Skip A_{i,p} = 0 for p > i, see triangular.c
+	const int lower_A = trmm_lower_A();
+
 	if (rid == root_rid)
 	{
 		/* Initialize with 0 because the initial value will be random garbage,
@@ -118,14 +124,15 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 			for (int p0 = 0; p0 < m0; p0 += block_size)
 			{
 				int pp_max = MIN(p0 + block_size, m0);
-				for (int i0 = 0; i0 <= j0; i0 += block_size)
+				// The blocks of A left of p0 are all zero
+				for (int i0 = lower_A ? p0 : 0; i0 <= j0; i0 += block_size)
 				{
 					for (int jj = j0; jj < jj_max; ++jj)
 					{
-						int ii_max = MIN(i0 + block_size, jj);
+						int ii_max = MIN(MIN(i0 + block_size, jj), m0);
 						// This checks if along the diagonal or not. If the block (ii_max - i)
 						// is large enough, it isn't on the diagonal, and we can proceed with
-						// simd. Otherwise use default
+						// simd. Otherwise use the masked diagonal path
 						if (ii_max - i0 >= block_size)
 						{
 							for (int pp = p0; pp < pp_max; ++pp)
@@ -145,17 +152,34 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 								}
 							}
 						}
-						else
+						else if (ii_max > i0)
 						{
+							// Diagonal tile: full vectors while eight rows fit below
+							// ii_max, then a single masked vector for the leftover rows.
+							int ii_vec = i0 + ((ii_max - i0) & ~7);
+							__m256i tail_mask = getTailMask(ii_max - ii_vec);
 							for (int pp = p0; pp < pp_max; ++pp)
 							{
-								float B_pj = B_distributed[pp * cs_B + jj * rs_B];
-								for (int ii = i0; ii < ii_max; ++ii)
+								__m256 B_pj = _mm256_set1_ps(B_distributed[pp * cs_B + jj * rs_B]);
+								for (int ii = i0; ii < ii_vec; ii += 8)
+								{
+									__m256 A_ip = _mm256_loadu_ps(
+									    &A_distributed[ii * cs_A + pp * rs_A]);
+									__m256 C = _mm256_loadu_ps(
+									    &C_distributed[ii * cs_C + jj * rs_C]);
+									C = _mm256_fmadd_ps(A_ip, B_pj, C);
+									_mm256_storeu_ps(
+									    &C_distributed[ii * cs_C + jj * rs_C], C);
+								}
+								if (ii_vec < ii_max)
 								{
-									float A_ip =
-									    A_distributed[ii * cs_A + pp * rs_A];
-									C_distributed[ii * cs_C + jj * rs_C] +=
-									    A_ip * B_pj;
+									__m256 A_ip = _mm256_maskload_ps(
+									    &A_distributed[ii_vec * cs_A + pp * rs_A], tail_mask);
+									__m256 C = _mm256_maskload_ps(
+									    &C_distributed[ii_vec * cs_C + jj * rs_C], tail_mask);
+									C = _mm256_fmadd_ps(A_ip, B_pj, C);
+									_mm256_maskstore_ps(
+									    &C_distributed[ii_vec * cs_C + jj * rs_C], tail_mask, C);
 								}
 							}
 						}
@@ -325,9 +349,9 @@ void DISTRIBUTED_ALLOCATE_NAME(int m0, int n0, float **A_distributed, float **B_
 	if (rid == root_rid)
 	{
 
-		*A_distributed = (float *)malloc(sizeof(float) * m0 * m0);
-		*C_distributed = (float *)malloc(sizeof(float) * m0 * n0);
-		*B_distributed = (float *)malloc(sizeof(float) * m0 * n0);
+		*A_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * m0);
+		*C_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * n0);
+		*B_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * n0);
 	}
 	else
 	{
@@ -363,13 +387,13 @@ void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequenti
 	// Note: Here is a perfect opportunity to change the layout
 	//       of your data which has the potential to give you
 	//       a sizeable performance gain.
-	// Layout for distributed data
+	// Layout for distributed data, columns padded by trmm_padded_ld()
 	// A is column major
-	int rs_AD = m0;
+	int rs_AD = trmm_padded_ld(m0);
 	int cs_AD = 1;
 
 	// B is column major
-	int rs_BD = m0;
+	int rs_BD = trmm_padded_ld(m0);
 	int cs_BD = 1;
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
@@ -378,18 +402,10 @@ void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequenti
 	if (rid == root_rid)
 	{
 		// Distribute the inputs
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int p0 = 0; p0 < m0; ++p0)
-			{
-				A_distributed[i0 * cs_AD + p0 * rs_AD] = A_sequential[i0 * cs_AS + p0 * rs_AS];
-			}
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
 
 		// Distribute the weights
-		for (int p0 = 0; p0 < m0; ++p0)
-			for (int j0 = 0; j0 < n0; ++j0)
-			{
-				B_distributed[p0 * cs_BD + j0 * rs_BD] = B_sequential[p0 * cs_BS + j0 * rs_BS];
-			}
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
 	}
 	else
 	{
@@ -424,9 +440,9 @@ void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential
 	// Note: Here is a perfect opportunity to change the layout
 	//       of your data which has the potential to give you
 	//       a sizeable performance gain.
-	// Layout for distributed data
+	// Layout for distributed data, columns padded by trmm_padded_ld()
 	// C is column major
-	int rs_CD = m0;
+	int rs_CD = trmm_padded_ld(m0);
 	int cs_CD = 1;
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
@@ -436,9 +452,7 @@ void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential
 	{
 
 		// Collect the output
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int j0 = 0; j0 < n0; ++j0)
-				C_sequential[i0 * cs_CS + j0 * rs_CS] = C_distributed[i0 * cs_CD + j0 * rs_CD];
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
 	}
 	else
 	{
@@ -472,9 +486,9 @@ void DISTRIBUTED_FREE_NAME(int m0, int n0, float *A_distributed, float *B_distri
 	if (rid == root_rid)
 	{
 
-		free(A_distributed);
-		free(B_distributed);
-		free(C_distributed);
+		trmm_free(A_distributed);
+		trmm_free(B_distributed);
+		trmm_free(C_distributed);
 	}
 	else
 	{
@@ -0,0 +1,424 @@
+/*
+  This is the baseline implementation of a Triangular Matrix Times Matrix
+  Multiplication  (TRMM)
+
+  C = AB, where
+  A is an MxM lower triangular (A_{i,p} = 0 if p > i) Matrix. It is indexed by i0 and p0
+  B is an MxN matrix. It is indexed by p0 and j0.
+  C is an MxN matrix. It is indexed by i0 and j0.
+
+
+  Parameters:
+
+  m0 > 0: dimension
+  n0 > 0: dimension
+
+
+
+  float* A_sequential: pointer to original A matrix data
+  float* A_distributed: pointer to the input data that you have distributed across
+  the system
+
+  float* C_sequential:  pointer to original output data
+  float* C_distributed: pointer to the output data that you have distributed across
+  the system
+
+  float* B_sequential:  pointer to original weights data
+  float* B_distributed: pointer to the weights data that you have distributed across
+  the system
+
+  Functions:
+
+  DISTRIBUTED_ALLOCATE_NAME(...): Allocate the distributed buffers.
+  DISTRIBUTE_DATA_NAME(...): takes the sequential data and distributes it across the system.
+  COMPUTE_NAME(...): Performs the stencil computation.
+  COLLECT_DATA_NAME(...): Collect the distributed output and combine it back to the sequential
+  one for testing.
+  DISTRIBUTED_FREE_NAME(...): Free the distributed buffers that were allocated
+
+
+  - richard.m.veras@ou.edu
+
+*/
+
+#include "layout_copy.c"
+#include "triangular.c"
+#include "trmm_alloc.c"
+#include <immintrin.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#ifndef COMPUTE_NAME
+#define COMPUTE_NAME baseline
+#endif
+
+#ifndef DISTRIBUTE_DATA_NAME
+#define DISTRIBUTE_DATA_NAME baseline_distribute
+#endif
+
+#ifndef COLLECT_DATA_NAME
+#define COLLECT_DATA_NAME baseline_collect
+#endif
+
+#ifndef DISTRIBUTED_ALLOCATE_NAME
+#define DISTRIBUTED_ALLOCATE_NAME baseline_allocate
+#endif
+
+#ifndef DISTRIBUTED_FREE_NAME
+#define DISTRIBUTED_FREE_NAME baseline_free
+#endif
+
+// Columns of C held in registers at once. 4 columns of a 64 row block are
+// 16 zmm accumulators, leaving room for the 4 A vectors and the B broadcast.
+#define COLS_PER_STEP 4
+
+/*
+  Same j0/p0/i0 blocking as SIMD.c, but 16 floats per op and C kept in zmm
+  registers for the whole pp loop of a block. Each column jj only keeps rows
+  ii < jj, which becomes a __mmask16 per 16 rows, so tiles on the diagonal
+  (and past m0) run through the same loop as the interior ones. With
+  lower_A the blocks of A left of the diagonal block are known to be zero
+  and skipped.
+*/
+__attribute__((target("avx512f"))) static void trmm_avx512(int m0, int n0, const float *A_distributed,
+							     const float *B_distributed, float *C_distributed,
+							     int block_size, int lower_A)
+{
+	// A is column major
+	int rs_A = m0;
+	int cs_A = 1;
+
+	// B is column major
+	int rs_B = m0;
+	int cs_B = 1;
+
+	// C is column major
+	int rs_C = m0;
+	int cs_C = 1;
+
+	for (int j0 = 0; j0 < n0; j0 += block_size)
+	{
+		int jj_max = MIN(j0 + block_size, n0);
+		for (int p0 = 0; p0 < m0; p0 += block_size)
+		{
+			int pp_max = MIN(p0 + block_size, m0);
+			for (int i0 = lower_A ? p0 : 0; i0 <= j0 && i0 < m0; i0 += block_size)
+			{
+				for (int jj = j0; jj < jj_max; jj += COLS_PER_STEP)
+				{
+					// One mask per (column, 16 rows) of the block, and their union for A
+					__mmask16 k_C[COLS_PER_STEP][4];
+					__mmask16 k_A[4] = {0, 0, 0, 0};
+					int B_col[COLS_PER_STEP];
+					for (int c = 0; c < COLS_PER_STEP; ++c)
+					{
+						int ii_max = jj + c < jj_max ? MIN(MIN(i0 + block_size, jj + c), m0) : i0;
+						B_col[c] = MIN(jj + c, jj_max - 1);
+						for (int v = 0; v < 4; ++v)
+						{
+							int rows = ii_max - (i0 + 16 * v);
+							k_C[c][v] = (__mmask16)(rows >= 16 ? 0xFFFF : rows <= 0 ? 0 : (1u << rows) - 1);
+							k_A[v] |= k_C[c][v];
+						}
+					}
+					if (k_A[0] == 0)
+						continue;
+
+					__m512 C[COLS_PER_STEP][4];
+#pragma GCC unroll 4
+					for (int c = 0; c < COLS_PER_STEP; ++c)
+#pragma GCC unroll 4
+						for (int v = 0; v < 4; ++v)
+							C[c][v] = _mm512_maskz_loadu_ps(
+							    k_C[c][v], &C_distributed[(i0 + 16 * v) * cs_C + (jj + c) * rs_C]);
+
+					for (int pp = p0; pp < pp_max; ++pp)
+					{
+						__m512 A_ip[4];
+#pragma GCC unroll 4
+						for (int v = 0; v < 4; ++v)
+							A_ip[v] = _mm512_maskz_loadu_ps(
+							    k_A[v], &A_distributed[(i0 + 16 * v) * cs_A + pp * rs_A]);
+#pragma GCC unroll 4
+						for (int c = 0; c < COLS_PER_STEP; ++c)
+						{
+							// "Broadcast" B values
+							__m512 B_pj = _mm512_set1_ps(B_distributed[pp * cs_B + B_col[c] * rs_B]);
+#pragma GCC unroll 4
+							for (int v = 0; v < 4; ++v)
+								C[c][v] = _mm512_fmadd_ps(A_ip[v], B_pj, C[c][v]);
+						}
+					}
+
+#pragma GCC unroll 4
+					for (int c = 0; c < COLS_PER_STEP; ++c)
+#pragma GCC unroll 4
+						for (int v = 0; v < 4; ++v)
+							_mm512_mask_storeu_ps(&C_distributed[(i0 + 16 * v) * cs_C + (jj + c) * rs_C],
+									      k_C[c][v], C[c][v]);
+				}
+			}
+		}
+	}
+}
+
+// Fallback for CPUs without AVX-512, same loop order as SIMD.c without vectors
+static void trmm_scalar(int m0, int n0, const float *A_distributed, const float *B_distributed,
+			float *C_distributed, int block_size, int lower_A)
+{
+	// A is column major
+	int rs_A = m0;
+	int cs_A = 1;
+
+	// B is column major
+	int rs_B = m0;
+	int cs_B = 1;
+
+	// C is column major
+	int rs_C = m0;
+	int cs_C = 1;
+
+	for (int j0 = 0; j0 < n0; j0 += block_size)
+	{
+		int jj_max = MIN(j0 + block_size, n0);
+		for (int p0 = 0; p0 < m0; p0 += block_size)
+		{
+			int pp_max = MIN(p0 + block_size, m0);
+			for (int i0 = lower_A ? p0 : 0; i0 <= j0; i0 += block_size)
+			{
+				for (int jj = j0; jj < jj_max; ++jj)
+				{
+					int ii_max = MIN(MIN(i0 + block_size, jj), m0);
+					for (int pp = p0; pp < pp_max; ++pp)
+					{
+						float B_pj = B_distributed[pp * cs_B + jj * rs_B];
+						for (int ii = i0; ii < ii_max; ++ii)
+						{
+							float A_ip = A_distributed[ii * cs_A + pp * rs_A];
+							C_distributed[ii * cs_C + jj * rs_C] += A_ip * B_pj;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// C is column major
+	int rs_C = m0;
+	int cs_C = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	// Four zmm registers per column
+	const int block_size = 64;
+
+	// Skip A_{i,p} = 0 for p > i, see triangular.c
+	const int lower_A = trmm_lower_A();
+
+	if (rid == root_rid)
+	{
+		/* Initialize with 0 because the initial value will be random garbage,
+		   necessary because using += operator in the i0 loop */
+		for (int i0 = 0; i0 < n0; ++i0)
+		{
+			for (int p0 = 0; p0 < m0; ++p0)
+			{
+				C_distributed[i0 * rs_C + p0] = 0.0f;
+			}
+		}
+
+		if (__builtin_cpu_supports("avx512f"))
+			trmm_avx512(m0, n0, A_distributed, B_distributed, C_distributed, block_size, lower_A);
+		else
+			trmm_scalar(m0, n0, A_distributed, B_distributed, C_distributed, block_size, lower_A);
+	}
+	else
+	{
+		/* STUDENT_TODO: Modify this is you plan to use more
+		 than 1 rank to do work in distributed memory context. */
+	}
+}
+
+// Create the buffers on each node
+void DISTRIBUTED_ALLOCATE_NAME(int m0, int n0, float **A_distributed, float **B_distributed, float **C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		*A_distributed = trmm_alloc((size_t)m0 * m0);
+		*C_distributed = trmm_alloc((size_t)m0 * n0);
+		*B_distributed = trmm_alloc((size_t)m0 * n0);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of its buffers allocated.
+		*/
+	}
+}
+
+void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequential, float *A_distributed,
+			  float *B_distributed)
+{
+
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	int rs_AS = m0;
+	int cs_AS = 1;
+
+	// B is column major
+	int rs_BS = m0;
+	int cs_BS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data
+	// A is column major
+	int rs_AD = m0;
+	int cs_AD = 1;
+
+	// B is column major
+	int rs_BD = m0;
+	int cs_BD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		// Distribute the inputs
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
+
+		// Distribute the weights
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of the necessary data for the computation.
+	      All other ranks have garbage in their data. This is where
+	      rank with rid == 0 needs to SEND data to the other nodes
+	      to RECEIVE the data, or use COLLECTIVE COMMUNICATION to
+	      distribute the data.
+		*/
+	}
+}
+
+void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	// C is column major
+	int rs_CS = m0;
+	int cs_CS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data
+	// C is column major
+	int rs_CD = m0;
+	int cs_CD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		// Collect the output
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 performs the computation and copies the
+	      "distributed" data to the "sequential" buffer that
+	      is checked by the verifier on rank rid == 0. If the
+	      other ranks contributed to the computation, then
+	      rank rid == 0 needs to RECEIVE the contributions that
+	      the other ranks SEND, or use COLLECTIVE COMMUNICATIONS
+	      for the same result.
+		*/
+	}
+}
+
+void DISTRIBUTED_FREE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		trmm_free(A_distributed);
+		trmm_free(B_distributed);
+		trmm_free(C_distributed);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 allocates the "distributed" buffers for itself.
+	      If the other ranks were modified to allocate their own
+	      buffers then they need to be freed at the end.
+		*/
+	}
+}
\ No newline at end of file
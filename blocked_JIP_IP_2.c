@@ -41,6 +41,8 @@
 
 */
 
+#include "layout_copy.c"
+#include "triangular.c"
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -97,6 +99,9 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 
 	const int block_size = 64;
 
+	// Skip A_{i,p} = 0 for p > i, see triangular.c
+	const int lower_A = trmm_lower_A();
+
 	if (rid == root_rid)
 	{
 		for (int i0 = 0; i0 < n0; ++i0)
@@ -110,11 +115,12 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 		{
 			for (int i0 = 0; i0 < j0; i0 += block_size)
 			{
-				for (int p0 = 0; p0 < m0; p0 += block_size)
+				int p_end = lower_A ? MIN(MIN(i0 + block_size, j0), m0) : m0;
+				for (int p0 = 0; p0 < p_end; p0 += block_size)
 				{
 					for (int ii = i0; ii < MIN(i0 + block_size, j0); ++ii)
 					{
-						for (int pp = p0; pp < MIN(p0 + block_size, m0); ++pp)
+						for (int pp = p0; pp < MIN(p0 + block_size, p_end); ++pp)
 						{
 							float A_ip = A_distributed[ii * cs_A + pp * rs_A];
 							float B_pj = B_distributed[pp * cs_B + j0 * rs_B];
@@ -356,18 +362,10 @@ void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequenti
 	if (rid == root_rid)
 	{
 		// Distribute the inputs
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int p0 = 0; p0 < m0; ++p0)
-			{
-				A_distributed[i0 * cs_AD + p0 * rs_AD] = A_sequential[i0 * cs_AS + p0 * rs_AS];
-			}
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
 
 		// Distribute the weights
-		for (int p0 = 0; p0 < m0; ++p0)
-			for (int j0 = 0; j0 < n0; ++j0)
-			{
-				B_distributed[p0 * cs_BD + j0 * rs_BD] = B_sequential[p0 * cs_BS + j0 * rs_BS];
-			}
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
 	}
 	else
 	{
@@ -414,9 +412,7 @@ void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential
 	{
 
 		// Collect the output
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int j0 = 0; j0 < n0; ++j0)
-				C_sequential[i0 * cs_CS + j0 * rs_CS] = C_distributed[i0 * cs_CD + j0 * rs_CD];
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
 	}
 	else
 	{
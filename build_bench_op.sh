@@ -31,6 +31,7 @@ DISTRIBUTED_ALLOCATE_NAME_TST="test_allocate"
 DISTRIBUTED_FREE_NAME_TST="test_free"
 DISTRIBUTE_DATA_NAME_TST="test_distribute"
 COLLECT_DATA_NAME_TST="test_collect"
+COMPUTE_BATCH_NAME_TST="test_batch"
 
 TEST_RIG="timer_op.c"
 
@@ -47,6 +48,7 @@ ${CC} -std=gnu99 -O2 -c \
     -DDISTRIBUTED_FREE_NAME_TST=${DISTRIBUTED_FREE_NAME_TST} \
     -DDISTRIBUTE_DATA_NAME_TST=${DISTRIBUTE_DATA_NAME_TST} \
     -DCOLLECT_DATA_NAME_TST=${COLLECT_DATA_NAME_TST} \
+    -DCOMPUTE_BATCH_NAME_TST=${COMPUTE_BATCH_NAME_TST} \
     ${TEST_RIG} -static -fPIC -o ${TEST_RIG}.o
 
 # build the variants
@@ -56,6 +58,7 @@ ${CC} $CFLAGS -c \
     -DCOLLECT_DATA_NAME=${COLLECT_DATA_NAME_TST} \
     -DDISTRIBUTED_ALLOCATE_NAME=${DISTRIBUTED_ALLOCATE_NAME_TST}\
     -DDISTRIBUTED_FREE_NAME=${DISTRIBUTED_FREE_NAME_TST}\
+    -DCOMPUTE_BATCH_NAME=${COMPUTE_BATCH_NAME_TST}\
     ${OP_SUBMISSION_VAR01_FILE} -o ${OP_SUBMISSION_VAR01_FILE}.o
 
 ${CC} $CFLAGS -c \
@@ -64,6 +67,7 @@ ${CC} $CFLAGS -c \
     -DCOLLECT_DATA_NAME=${COLLECT_DATA_NAME_TST} \
     -DDISTRIBUTED_ALLOCATE_NAME=${DISTRIBUTED_ALLOCATE_NAME_TST}\
     -DDISTRIBUTED_FREE_NAME=${DISTRIBUTED_FREE_NAME_TST}\
+    -DCOMPUTE_BATCH_NAME=${COMPUTE_BATCH_NAME_TST}\
     ${OP_SUBMISSION_VAR02_FILE} -o ${OP_SUBMISSION_VAR02_FILE}.o
 
 ${CC} $CFLAGS -c \
@@ -72,6 +76,7 @@ ${CC} $CFLAGS -c \
     -DCOLLECT_DATA_NAME=${COLLECT_DATA_NAME_TST} \
     -DDISTRIBUTED_ALLOCATE_NAME=${DISTRIBUTED_ALLOCATE_NAME_TST}\
     -DDISTRIBUTED_FREE_NAME=${DISTRIBUTED_FREE_NAME_TST}\
+    -DCOMPUTE_BATCH_NAME=${COMPUTE_BATCH_NAME_TST}\
     ${OP_SUBMISSION_VAR03_FILE} -o ${OP_SUBMISSION_VAR03_FILE}.o
 
 
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+#
+# This file builds the synchronization micro-benchmark. It is standalone,
+# no variant is needed.
+#
+# Run it with the same size arguments as the timer, e.g.
+#   OMP_NUM_THREADS=8 ./run_sync_bench_op.x 256 1025 256 1 1 result_sync_bench.csv
+
+# Turn on command echo for debugging
+set -x
+
+source op_dispatch_vars.sh
+
+echo $CC
+echo $CFLAGS
+
+SYNC_BENCH="sync_bench_op.c"
+
+${CC} $CFLAGS -std=gnu99 ${SYNC_BENCH} -o ./run_sync_bench_op.x -lm
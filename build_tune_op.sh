@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+#
+# This file builds the autotuner for the packed engine. It includes
+# packed_kernels.c and packed_tuning.c directly, so no variant is needed.
+#
+# Run it with the same size arguments as the timer, e.g.
+#   ./run_tune_op.x 64 1024 64 1 1 trmm_tuning.csv
+# and the packed variants will pick up trmm_tuning.csv at run time.
+
+# Turn on command echo for debugging
+set -x
+
+source op_dispatch_vars.sh
+
+echo $CC
+echo $CFLAGS
+
+TUNER="tune_op.c"
+
+${CC} $CFLAGS -std=gnu99 ${TUNER} -o ./run_tune_op.x
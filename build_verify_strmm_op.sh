@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+#
+# This file builds the verifier of trmm_strmm() in trmm_blas.c. It is
+# standalone, no variant is needed.
+#
+# Run it with the same size arguments as the timer, e.g.
+#   ./run_verify_strmm_op.x 1 300 17 1 1 result_verify_strmm.csv
+# Every size runs 128 cases against a naive reference, so keep max small.
+
+# Turn on command echo for debugging
+set -x
+
+source op_dispatch_vars.sh
+
+echo $CC
+echo $CFLAGS
+
+VERIFY_STRMM="verify_strmm_op.c"
+
+${CC} $CFLAGS -std=gnu99 ${VERIFY_STRMM} -o ./run_verify_strmm_op.x -lm
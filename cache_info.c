@@ -0,0 +1,158 @@
+/*
+  Cache sizes of this machine and the cache blocks derived from them.
+
+  The sizes are read once from the indexN directories of
+  /sys/devices/system/cpu/cpu0/cache (level, type and size of every cache).
+  Levels that are missing from sysfs fall back to common values.
+
+  cache_blocks() turns them into the three blocks of a
+  C(mc x nc) += A(mc x kc) * B(kc x nc) loop nest whose innermost tile is
+  mr x nr:
+
+  kc: an mr x kc sliver of A and a kc x nr sliver of B fill L1
+  mc: the mc x kc block of A fills half of L2
+  nc: the kc x nc block of B fills half of L3
+
+  TRMM_MC, TRMM_KC and TRMM_NC override the computed values. They are rounded
+  up to a multiple of mr, CACHE_KC_STEP and nr: per-thread packing buffers are
+  laid out back to back in slices of (mc + padding) * kc floats and are read
+  with aligned loads, so every slice has to start on a cache line.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_SYSFS_DIR "/sys/devices/system/cpu/cpu0/cache"
+#define CACHE_MAX_INDEX 8
+
+// Used when sysfs does not report a level
+#define CACHE_DEFAULT_L1 (32L * 1024)
+#define CACHE_DEFAULT_L2 (1024L * 1024)
+#define CACHE_DEFAULT_L3 (8L * 1024 * 1024)
+
+// kc granularity of the overrides, one cache line of floats
+#define CACHE_KC_STEP 16
+
+typedef struct
+{
+	long l1d;
+	long l2;
+	long l3;
+} cache_sizes;
+
+// Read the first line of a sysfs file into buf. Returns 0 if it does not exist.
+static int cache_read_sysfs(int index, const char *name, char *buf, int buf_size)
+{
+	char path[128];
+	snprintf(path, sizeof(path), CACHE_SYSFS_DIR "/index%d/%s", index, name);
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+		return 0;
+
+	int ok = fgets(buf, buf_size, file) != NULL;
+	fclose(file);
+	return ok;
+}
+
+// Sizes look like "48K", "2048K" or "32M"
+static long cache_parse_size(const char *text)
+{
+	char *end;
+	long size = strtol(text, &end, 10);
+	if (*end == 'K')
+		size *= 1024;
+	else if (*end == 'M')
+		size *= 1024 * 1024;
+	return size;
+}
+
+static cache_sizes cache_detect(void)
+{
+	static cache_sizes sizes;
+	static int detected = 0;
+
+	if (detected)
+		return sizes;
+
+	sizes.l1d = 0;
+	sizes.l2 = 0;
+	sizes.l3 = 0;
+
+	for (int index = 0; index < CACHE_MAX_INDEX; ++index)
+	{
+		char level[16], type[32], size[32];
+		if (!cache_read_sysfs(index, "level", level, sizeof(level)) ||
+		    !cache_read_sysfs(index, "type", type, sizeof(type)) ||
+		    !cache_read_sysfs(index, "size", size, sizeof(size)))
+			continue;
+
+		// Skip the instruction caches
+		if (strncmp(type, "Instruction", 11) == 0)
+			continue;
+
+		long bytes = cache_parse_size(size);
+		switch (atoi(level))
+		{
+		case 1:
+			sizes.l1d = bytes;
+			break;
+		case 2:
+			sizes.l2 = bytes;
+			break;
+		case 3:
+			sizes.l3 = bytes;
+			break;
+		}
+	}
+
+	if (sizes.l1d <= 0)
+		sizes.l1d = CACHE_DEFAULT_L1;
+	if (sizes.l2 <= 0)
+		sizes.l2 = CACHE_DEFAULT_L2;
+	// Without an L3 the B block has to share L2 with the A block
+	if (sizes.l3 <= 0)
+		sizes.l3 = sizes.l2 > 0 ? sizes.l2 : CACHE_DEFAULT_L3;
+
+	detected = 1;
+	return sizes;
+}
+
+// Round value down to a multiple of step and clamp it to [lo, hi]
+static int cache_round_block(long value, int step, int lo, int hi)
+{
+	value -= value % step;
+	if (value < lo)
+		value = lo;
+	if (value > hi)
+		value = hi - hi % step;
+	return (int)value;
+}
+
+// Round value up to a multiple of step
+static int cache_round_up(int value, int step)
+{
+	return (value + step - 1) / step * step;
+}
+
+// Positive integer from the environment rounded up to a multiple of step, or fallback
+static int cache_env_block(const char *name, int fallback, int step)
+{
+	const char *text = getenv(name);
+	int value = text != NULL ? atoi(text) : 0;
+	return value > 0 ? cache_round_up(value, step) : fallback;
+}
+
+static void cache_blocks(int mr, int nr, int *mc, int *kc, int *nc)
+{
+	cache_sizes sizes = cache_detect();
+
+	*kc = cache_round_block(sizes.l1d / ((long)(mr + nr) * sizeof(float)), 8, 64, 1024);
+	*mc = cache_round_block(sizes.l2 / 2 / ((long)*kc * sizeof(float)), mr, mr, 4096);
+	*nc = cache_round_block(sizes.l3 / 2 / ((long)*kc * sizeof(float)), nr, nr, 16384);
+
+	*mc = cache_env_block("TRMM_MC", *mc, mr);
+	*kc = cache_env_block("TRMM_KC", *kc, CACHE_KC_STEP);
+	*nc = cache_env_block("TRMM_NC", *nc, nr);
+}
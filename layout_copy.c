@@ -0,0 +1,57 @@
+/*
+  Copies between the sequential and distributed layouts of the variants.
+
+  A layout is the (rs, cs) pair the variants use: element (i, j) of the
+  matrix sits at i * cs + j * rs, so column major with leading dimension m0
+  is rs = m0, cs = 1.
+
+  On a single rank the distributed layout usually is the sequential one. The
+  copy is then one memcpy of the whole matrix, or nothing at all when both
+  pointers are the same buffer. Otherwise the loops walk the destination
+  contiguously.
+*/
+
+#ifndef LAYOUT_COPY_C
+#define LAYOUT_COPY_C
+
+#include <string.h>
+
+static void layout_copy(int m, int n, const float *src, int rs_src, int cs_src, float *dst, int rs_dst, int cs_dst)
+{
+	if (m <= 0 || n <= 0)
+		return;
+
+	int same_layout = rs_src == rs_dst && cs_src == cs_dst;
+	if (same_layout && src == dst)
+		return;
+
+	// Dense column major on both sides
+	if (same_layout && cs_src == 1 && rs_src == m)
+	{
+		memcpy(dst, src, sizeof(float) * m * n);
+		return;
+	}
+
+	// Contiguous columns, only the leading dimensions differ
+	if (cs_src == 1 && cs_dst == 1)
+	{
+		for (int j0 = 0; j0 < n; ++j0)
+			memcpy(&dst[j0 * rs_dst], &src[j0 * rs_src], sizeof(float) * m);
+		return;
+	}
+
+	if (cs_dst == 1)
+	{
+		for (int j0 = 0; j0 < n; ++j0)
+			for (int i0 = 0; i0 < m; ++i0)
+				dst[i0 + j0 * rs_dst] = src[i0 * cs_src + j0 * rs_src];
+	}
+	else
+	{
+		for (int i0 = 0; i0 < m; ++i0)
+			for (int j0 = 0; j0 < n; ++j0)
+				dst[i0 * cs_dst + j0 * rs_dst] = src[i0 * cs_src + j0 * rs_src];
+	}
+}
+
+#endif // LAYOUT_COPY_C
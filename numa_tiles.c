@@ -0,0 +1,78 @@
+/*
+  Which NUMA node holds which tile of a distributed buffer.
+
+  Linux places an anonymous page on the node of the thread that writes it
+  first, so a buffer filled by one thread ends up on one socket no matter
+  who computes on it later. The variants that care first-touch their
+  buffers in DISTRIBUTE_DATA_NAME from the threads that compute on them;
+  these helpers check where the pages actually went:
+
+  numa_thread_node()                     node of the cpu the caller runs on
+  numa_tile_node(buffer, ld, rows, cols) node holding most columns of the
+                                         rows x cols tile at buffer (column
+                                         major, leading dimension ld)
+
+  Both return -1 when the kernel cannot tell (no NUMA support, or no page of
+  the tile touched yet). Placement is per page, so with the 2 MB pages of
+  trmm_alloc() a tile narrower than a huge page shares its node with its
+  neighbours.
+*/
+
+#ifndef NUMA_TILES_C
+#define NUMA_TILES_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+
+// -std=c99 hides syscall() and there is no glibc wrapper for move_pages
+long syscall(long number, ...);
+
+#define NUMA_MAX_NODES 64
+#define NUMA_PAGE_SIZE 4096
+
+static int numa_thread_node(void)
+{
+	unsigned int cpu = 0;
+	unsigned int node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+		return -1;
+	return (int)node;
+}
+
+static int numa_tile_node(const float *buffer, int ld, int rows, int cols)
+{
+	enum
+	{
+		batch = 64
+	};
+	int count[NUMA_MAX_NODES] = {0};
+
+	if (rows <= 0)
+		return -1;
+
+	// Ask for the page of the first element of each column, batch at a time
+	for (int c0 = 0; c0 < cols; c0 += batch)
+	{
+		void *pages[batch];
+		int status[batch];
+		int num = cols - c0 < batch ? cols - c0 : batch;
+		for (int c = 0; c < num; ++c)
+			pages[c] = (void *)((uintptr_t)&buffer[(size_t)(c0 + c) * ld] & ~(uintptr_t)(NUMA_PAGE_SIZE - 1));
+
+		// Without a node list move_pages only reports where the pages are
+		if (syscall(SYS_move_pages, 0, (unsigned long)num, pages, NULL, status, 0) != 0)
+			return -1;
+		for (int c = 0; c < num; ++c)
+			if (status[c] >= 0 && status[c] < NUMA_MAX_NODES)
+				++count[status[c]];
+	}
+
+	int best = -1;
+	for (int node = 0; node < NUMA_MAX_NODES; ++node)
+		if (count[node] > 0 && (best < 0 || count[node] > count[best]))
+			best = node;
+	return best;
+}
+
+#endif // NUMA_TILES_C
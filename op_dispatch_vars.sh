@@ -26,6 +26,12 @@ OP_SUBMISSION_VAR03_FILE="blocked_JPI_3.c"
 CC=mpicc
 CFLAGS="-std=c99 -O2 -mavx2 -mfma -fopenmp"
 
+# The packed_* and recursive_SIMD.c variants select their micro-kernel at run
+# time (override with TRMM_ISA=sse|avx2|avx512) and SIMD_AVX512.c checks for
+# AVX-512 itself, so they do not need -mavx2 -mfma. Building them with these flags gives one
+# binary that runs on every x86-64 node:
+# CFLAGS="-std=c99 -O2 -fopenmp"
+
 # CC_HOST=mpicc
 # CC_HOST_CFLAGS="-std=c99 -O2 -mavx2 -mfma"
 # CC=nvcc
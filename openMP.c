@@ -41,6 +41,9 @@
 
 */
 
+#include "layout_copy.c"
+#include "openmp_ksplit.c"
+#include "partition.c"
 #include <mpi.h>
 #include <omp.h>
 #include <stdio.h>
@@ -68,6 +71,10 @@
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
+// Column split granularity: the inner loops run down whole columns of C,
+// so a cut between any two columns splits no vector
+#define PARTITION_ALIGN 1
+
 void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
 
 {
@@ -108,16 +115,27 @@ void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, fl
 				C_distributed[i0 * rs_C + p0] = 0.0f;
 			}
 		}
-#pragma omp parallel for num_threads(2) collapse(2) /*reduction(+:C_distributed[:n0*m0])*/
-		for (int j0 = 0; j0 < n0; ++j0)
+		// Too few columns for the threads: split p instead
+		if (openmp_ksplit_wanted(m0, n0, 2))
+			openmp_ksplit_trmm(m0, n0, A_distributed, B_distributed, C_distributed, 2);
+		else
 		{
-			for (int p0 = 0; p0 < m0; ++p0)
+			// Every thread owns whole columns of C, split by flop count
+#pragma omp parallel num_threads(2)
 			{
-                float B_pj = B_distributed[p0 * cs_B + j0 * rs_B];
-				for (int i0 = 0; i0 < j0; ++i0)
+				int j_begin, j_end;
+				partition_columns(m0, n0, PARTITION_ALIGN, omp_get_thread_num(), omp_get_num_threads(), &j_begin, &j_end);
+				for (int j0 = j_begin; j0 < j_end; ++j0)
 				{
-					float A_ip = A_distributed[i0 * cs_A + p0 * rs_A];
-					C_distributed[i0 * cs_C + j0 * rs_C] += A_ip * B_pj;
+					for (int p0 = 0; p0 < m0; ++p0)
+					{
+						float B_pj = B_distributed[p0 * cs_B + j0 * rs_B];
+						for (int i0 = 0; i0 < j0; ++i0)
+						{
+							float A_ip = A_distributed[i0 * cs_A + p0 * rs_A];
+							C_distributed[i0 * cs_C + j0 * rs_C] += A_ip * B_pj;
+						}
+					}
 				}
 			}
 		}
@@ -219,18 +237,10 @@ void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequenti
 	if (rid == root_rid)
 	{
 		// Distribute the inputs
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int p0 = 0; p0 < m0; ++p0)
-			{
-				A_distributed[i0 * cs_AD + p0 * rs_AD] = A_sequential[i0 * cs_AS + p0 * rs_AS];
-			}
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
 
 		// Distribute the weights
-		for (int p0 = 0; p0 < m0; ++p0)
-			for (int j0 = 0; j0 < n0; ++j0)
-			{
-				B_distributed[p0 * cs_BD + j0 * rs_BD] = B_sequential[p0 * cs_BS + j0 * rs_BS];
-			}
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
 	}
 	else
 	{
@@ -277,9 +287,7 @@ void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential
 	{
 
 		// Collect the output
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int j0 = 0; j0 < n0; ++j0)
-				C_sequential[i0 * cs_CS + j0 * rs_CS] = C_distributed[i0 * cs_CD + j0 * rs_CD];
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
 	}
 	else
 	{
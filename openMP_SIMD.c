@@ -41,12 +41,18 @@
 
 */
 
+#include "layout_copy.c"
+#include "numa_tiles.c"
+#include "thread_pool.c"
+#include "trmm_alloc.c"
 #include "utils.c"
+#include "work_stealing.c"
 #include <immintrin.h>
 #include <mpi.h>
 #include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
@@ -70,98 +76,416 @@
 #define DISTRIBUTED_FREE_NAME baseline_free
 #endif
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
-void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
-
-{
-	int rid;
-	int num_ranks;
-	int tag = 0;
-	MPI_Status status;
-	int root_rid = 0;
 
-	/*
+/*
+  Compute, distribute and the NUMA report run on the persistent pinned
+  threads of thread_pool.c (TRMM_NUM_THREADS, by default one per allowed
+  cpu) instead of an OpenMP team, so repeated calls do not pay for waking
+  up threads. openmp_simd_schedule_create() lists the 64 x 64 tiles of C
+  with I <= J and deals each thread a contiguous run of them of about
+  equal flops; column_owner names the thread whose run starts each column
+  block. Distribute copies a column block of B from its column_owner and
+  compute zeroes the rows of C of a tile in the thread that computes it,
+  so each page is first touched (and placed on the NUMA node of) the
+  pinned thread that works on it. A thread that finishes its run steals
+  tiles from the others, so a stolen tile may be computed on another
+  node. A is read by every thread and gets spread over them by column
+  blocks. TRMM_NUMA_REPORT=1 prints where the tiles ended up.
+*/
+#define OPENMP_SIMD_BLOCK 64
 
-	  Using the convention that row_stride (rs) is the step size you take going down a row,
-	  column stride (cs) is the step size going down the column.
-	*/
+/*
+  Tile (i0, j0) of C: zeroes it (and the rows below it if it is the last
+  tile of its columns), then adds A * B over it.
+*/
+static void openmp_simd_tile(int m0, int n0, int i0, int j0, const float *A_distributed, const float *B_distributed,
+			     float *C_distributed)
+{
 	// A is column major
-	int rs_A = m0;
+	int rs_A = trmm_padded_ld(m0);
 	int cs_A = 1;
 
 	// B is column major
-	int rs_B = m0;
+	int rs_B = trmm_padded_ld(m0);
 	int cs_B = 1;
 
 	// C is column major
-	int rs_C = m0;
+	int rs_C = trmm_padded_ld(m0);
 	int cs_C = 1;
 
-	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
-	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+	const int block_size = OPENMP_SIMD_BLOCK;
 
-	const int block_size = 64;
+	// Zero the tile here so it is first touched by the thread computing it
+	int i_end = i0 + block_size >= MIN(j0 + 1, m0) ? m0 : i0 + block_size;
+	for (int jj = j0; jj < MIN(j0 + block_size, n0); ++jj)
+		memset(&C_distributed[i0 + jj * rs_C], 0, sizeof(float) * (i_end - i0));
 
-	if (rid == root_rid)
+	for (int p0 = 0; p0 < m0; p0 += block_size)
 	{
-		for (int i0 = 0; i0 < n0; ++i0)
+		int jj_max = MIN(j0 + block_size, n0);
+		for (int jj = j0; jj < jj_max; ++jj)
 		{
-			for (int p0 = 0; p0 < m0; ++p0)
+			int ii_max = MIN(MIN(i0 + block_size, jj), m0);
+			int pp_max = MIN(p0 + block_size, m0);
+			// This checks if along the diagonal or not. If the block (ii_max - i)
+			// is large enough, it isn't on the diagonal, and we can proceed with
+			// simd. Otherwise use the masked diagonal path
+			if (ii_max - i0 >= block_size)
 			{
-				C_distributed[i0 * rs_C + p0] = 0.0f;
+				for (int pp = p0; pp < pp_max; ++pp)
+				{
+					// "Broadcast" B values
+					__m256 B_pj = _mm256_set1_ps(B_distributed[pp * cs_B + jj * rs_B]);
+					for (int ii = i0; ii < ii_max; ii += 8)
+					{
+						__m256 A_ip = _mm256_loadu_ps(
+						    &A_distributed[ii * cs_A + pp * rs_A]);
+						__m256 C = _mm256_loadu_ps(
+						    &C_distributed[ii * cs_C + jj * rs_C]);
+						C = _mm256_fmadd_ps(A_ip, B_pj, C);
+						_mm256_storeu_ps(
+						    &C_distributed[ii * cs_C + jj * rs_C], C);
+					}
+				}
 			}
-		}
-        #pragma omp parallel for num_threads(8)
-		for (int j0 = 0; j0 < n0; j0 += block_size)
-		{
-			for (int p0 = 0; p0 < m0; p0 += block_size)
+			else if (ii_max > i0)
 			{
-				for (int i0 = 0; i0 <= j0; i0 += block_size)
+				// Diagonal tile: full vectors while eight rows fit below
+				// ii_max, then a single masked vector for the leftover rows.
+				int ii_vec = i0 + ((ii_max - i0) & ~7);
+				__m256i tail_mask = getTailMask(ii_max - ii_vec);
+				for (int pp = p0; pp < pp_max; ++pp)
 				{
-                    int jj_max = MIN(j0 + block_size, n0);
-					for (int jj = j0; jj < jj_max; ++jj)
+					__m256 B_pj = _mm256_set1_ps(B_distributed[pp * cs_B + jj * rs_B]);
+					for (int ii = i0; ii < ii_vec; ii += 8)
 					{
-						int ii_max = MIN(i0 + block_size, jj);
-                        int pp_max = MIN(p0 + block_size, m0);
-                        // This checks if along the diagonal or not. If the block (ii_max - i)
-						// is large enough, it isn't on the diagonal, and we can proceed with
-						// simd. Otherwise use default
-						if (ii_max - i0 >= block_size)
-						{
-							for (int pp = p0; pp < pp_max; ++pp)
-							{
-                                // "Broadcast" B values
-								__m256 B_pj = _mm256_set1_ps(B_distributed[pp * cs_B + jj * rs_B]);
-								for (int ii = i0; ii < ii_max; ii += 8)
-								{
-									__m256 A_ip = _mm256_loadu_ps(
-									    &A_distributed[ii * cs_A + pp * rs_A]);
-									__m256 C = _mm256_loadu_ps(
-									    &C_distributed[ii * cs_C + jj * rs_C]);
-									C = _mm256_fmadd_ps(A_ip, B_pj, C);
-									_mm256_storeu_ps(
-									    &C_distributed[ii * cs_C + jj * rs_C], C);
-								}
-							}
-						}
-						else
-						{
-							for (int pp = p0; pp < pp_max; ++pp)
-							{
-								float B_pj = B_distributed[pp * cs_B + jj * rs_B];
-								for (int ii = i0; ii < ii_max; ++ii)
-								{
-									float A_ip =
-									    A_distributed[ii * cs_A + pp * rs_A];
-									C_distributed[ii * cs_C + jj * rs_C] +=
-									    A_ip * B_pj;
-								}
-							}
-						}
+						__m256 A_ip = _mm256_loadu_ps(
+						    &A_distributed[ii * cs_A + pp * rs_A]);
+						__m256 C = _mm256_loadu_ps(
+						    &C_distributed[ii * cs_C + jj * rs_C]);
+						C = _mm256_fmadd_ps(A_ip, B_pj, C);
+						_mm256_storeu_ps(
+						    &C_distributed[ii * cs_C + jj * rs_C], C);
+					}
+					if (ii_vec < ii_max)
+					{
+						__m256 A_ip = _mm256_maskload_ps(
+						    &A_distributed[ii_vec * cs_A + pp * rs_A], tail_mask);
+						__m256 C = _mm256_maskload_ps(
+						    &C_distributed[ii_vec * cs_C + jj * rs_C], tail_mask);
+						C = _mm256_fmadd_ps(A_ip, B_pj, C);
+						_mm256_maskstore_ps(
+						    &C_distributed[ii_vec * cs_C + jj * rs_C], tail_mask, C);
 					}
 				}
 			}
 		}
 	}
+}
+
+/*
+  The tiles of C with work, column block by column block, and how they are
+  dealt out: thread t starts with tiles [first[t], first[t + 1]), a
+  contiguous run of about the same number of flops (a diagonal tile is
+  about half a full one). With TRMM_STEAL=1 (the default) a thread that
+  runs out steals tiles from the others, see work_stealing.c; with
+  TRMM_STEAL=0 it only does its own.
+
+  The schedule only depends on (m0, n0, num_threads), so the last one is
+  kept across calls, see openmp_simd_schedule_for().
+*/
+typedef struct
+{
+	int m0;
+	int n0;
+	int num_threads;
+	int num_tiles;
+	int *tile_i0;
+	int *tile_j0;
+	int *ids;
+	int *first;
+	// Thread that starts with the first tile of each column block
+	int *column_owner;
+	ws_deque *queues;
+	int steal;
+} openmp_simd_schedule;
+
+typedef struct
+{
+	int m0;
+	int n0;
+	const float *A_sequential;
+	const float *B_sequential;
+	float *A_distributed;
+	float *B_distributed;
+	float *C_distributed;
+	openmp_simd_schedule *schedule;
+	// Tile counts of openmp_simd_numa_report()
+	int tiles_B;
+	int remote_B;
+	int tiles_C;
+	int remote_C;
+} openmp_simd_args;
+
+// Multiply adds of tile (i0, j0), in units of m0
+static double openmp_simd_tile_work(int m0, int n0, int i0, int j0)
+{
+	double work = 0.0;
+	for (int jj = j0; jj < MIN(j0 + OPENMP_SIMD_BLOCK, n0); ++jj)
+		work += MIN(MIN(i0 + OPENMP_SIMD_BLOCK, jj), m0) > i0 ? MIN(MIN(i0 + OPENMP_SIMD_BLOCK, jj), m0) - i0 : 0;
+	return work;
+}
+
+static void openmp_simd_schedule_destroy(openmp_simd_schedule *schedule)
+{
+	if (schedule == NULL)
+		return;
+	free(schedule->tile_i0);
+	free(schedule->tile_j0);
+	free(schedule->ids);
+	free(schedule->first);
+	free(schedule->column_owner);
+	free(schedule->queues);
+	free(schedule);
+}
+
+// Returns NULL if out of memory. The deques are not seeded yet.
+static openmp_simd_schedule *openmp_simd_schedule_create(int m0, int n0, int num_threads)
+{
+	const int block_size = OPENMP_SIMD_BLOCK;
+	int max_tiles = 0;
+	for (int j0 = 0; j0 < n0; j0 += block_size)
+		for (int i0 = 0; i0 <= j0 && i0 < m0; i0 += block_size)
+			++max_tiles;
+
+	openmp_simd_schedule *schedule = (openmp_simd_schedule *)calloc(1, sizeof(openmp_simd_schedule));
+	if (schedule == NULL)
+		return NULL;
+	schedule->m0 = m0;
+	schedule->n0 = n0;
+	schedule->num_threads = num_threads;
+
+	schedule->tile_i0 = (int *)malloc(sizeof(int) * (max_tiles + 1));
+	schedule->tile_j0 = (int *)malloc(sizeof(int) * (max_tiles + 1));
+	schedule->ids = (int *)malloc(sizeof(int) * (max_tiles + 1));
+	schedule->first = (int *)malloc(sizeof(int) * (num_threads + 1));
+	schedule->column_owner = (int *)malloc(sizeof(int) * ((n0 + block_size - 1) / block_size + 1));
+	schedule->queues = (ws_deque *)malloc(sizeof(ws_deque) * num_threads);
+	if (schedule->tile_i0 == NULL || schedule->tile_j0 == NULL || schedule->ids == NULL || schedule->first == NULL ||
+	    schedule->column_owner == NULL || schedule->queues == NULL)
+	{
+		openmp_simd_schedule_destroy(schedule);
+		return NULL;
+	}
+
+	const char *steal = getenv("TRMM_STEAL");
+	schedule->steal = steal == NULL || atoi(steal) > 0;
+
+	// Every tile with I <= J, including the ones without work: they zero C
+	double total = 0.0;
+	schedule->num_tiles = 0;
+	for (int j0 = 0; j0 < n0; j0 += block_size)
+		for (int i0 = 0; i0 <= j0 && i0 < m0; i0 += block_size)
+		{
+			schedule->tile_i0[schedule->num_tiles] = i0;
+			schedule->tile_j0[schedule->num_tiles] = j0;
+			schedule->ids[schedule->num_tiles] = schedule->num_tiles;
+			++schedule->num_tiles;
+			total += openmp_simd_tile_work(m0, n0, i0, j0);
+		}
+
+	// A tile belongs to the thread its midpoint in the running sum falls in
+	double before = 0.0;
+	int t = 0;
+	schedule->first[0] = 0;
+	for (int k = 0; k < schedule->num_tiles; ++k)
+	{
+		double work = openmp_simd_tile_work(m0, n0, schedule->tile_i0[k], schedule->tile_j0[k]);
+		int owner = total > 0.0 ? (int)((before + 0.5 * work) * num_threads / total) : 0;
+		while (t < MIN(owner, num_threads - 1))
+			schedule->first[++t] = k;
+		before += work;
+	}
+	while (t < num_threads)
+		schedule->first[++t] = schedule->num_tiles;
+
+	t = 0;
+	for (int k = 0; k < schedule->num_tiles; ++k)
+	{
+		while (k >= schedule->first[t + 1])
+			++t;
+		if (schedule->tile_i0[k] == 0)
+			schedule->column_owner[schedule->tile_j0[k] / block_size] = t;
+	}
+
+	return schedule;
+}
+
+/*
+  The schedule of the last shape and pool size, created on the first call
+  and kept until the buffers are freed, like the plan of
+  packed_plan_SIMD.c. NULL if out of memory.
+*/
+static openmp_simd_schedule *tile_schedule = NULL;
+
+static openmp_simd_schedule *openmp_simd_schedule_for(int m0, int n0, int num_threads)
+{
+	if (tile_schedule == NULL || tile_schedule->m0 != m0 || tile_schedule->n0 != n0 ||
+	    tile_schedule->num_threads != num_threads)
+	{
+		openmp_simd_schedule_destroy(tile_schedule);
+		tile_schedule = openmp_simd_schedule_create(m0, n0, num_threads);
+	}
+	return tile_schedule;
+}
+
+static void openmp_simd_compute_task(void *data, int tid, int num_threads)
+{
+	openmp_simd_args *args = (openmp_simd_args *)data;
+	openmp_simd_schedule *schedule = args->schedule;
+
+	for (;;)
+	{
+		int k = schedule->steal ? ws_next(schedule->queues, num_threads, tid) : ws_pop(&schedule->queues[tid]);
+		if (k == WS_EMPTY)
+			break;
+		openmp_simd_tile(args->m0, args->n0, schedule->tile_i0[k], schedule->tile_j0[k], args->A_distributed,
+				 args->B_distributed, args->C_distributed);
+	}
+}
+
+// Tile counts for openmp_simd_numa_report(), on the threads of compute
+static void openmp_simd_numa_task(void *data, int tid, int num_threads)
+{
+	openmp_simd_args *args = (openmp_simd_args *)data;
+	const openmp_simd_schedule *schedule = args->schedule;
+	const int block_size = OPENMP_SIMD_BLOCK;
+	int m0 = args->m0;
+	int n0 = args->n0;
+	int ld = trmm_padded_ld(m0);
+	int mine = numa_thread_node();
+
+	for (int j0 = 0; j0 < n0; j0 += block_size)
+	{
+		if (schedule->column_owner[j0 / block_size] != tid)
+			continue;
+		for (int p0 = 0; p0 < m0; p0 += block_size)
+		{
+			int node = numa_tile_node(&args->B_distributed[p0 + j0 * ld], ld, MIN(block_size, m0 - p0),
+						  MIN(block_size, n0 - j0));
+			__atomic_add_fetch(&args->tiles_B, 1, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&args->remote_B, node != mine, __ATOMIC_RELAXED);
+		}
+	}
+
+	// The tiles of C this thread starts with
+	for (int k = schedule->first[tid]; k < schedule->first[tid + 1]; ++k)
+	{
+		int i0 = schedule->tile_i0[k];
+		int j0 = schedule->tile_j0[k];
+		int node = numa_tile_node(&args->C_distributed[i0 + j0 * ld], ld, MIN(block_size, m0 - i0),
+					  MIN(block_size, n0 - j0));
+		__atomic_add_fetch(&args->tiles_C, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&args->remote_C, node != mine, __ATOMIC_RELAXED);
+	}
+}
+
+/*
+  Tiles of A per NUMA node, and how many tiles of B and C are on another
+  node than the thread that starts with them.
+*/
+static void openmp_simd_numa_report(int m0, int n0, float *A_distributed, float *B_distributed,
+				    float *C_distributed)
+{
+	const int block_size = OPENMP_SIMD_BLOCK;
+	int ld = trmm_padded_ld(m0);
+	int A_tiles[NUMA_MAX_NODES] = {0};
+
+	for (int p0 = 0; p0 < m0; p0 += block_size)
+		for (int i0 = 0; i0 < m0; i0 += block_size)
+		{
+			int node = numa_tile_node(&A_distributed[i0 + p0 * ld], ld, MIN(block_size, m0 - i0),
+						  MIN(block_size, m0 - p0));
+			if (node >= 0)
+				++A_tiles[node];
+		}
+
+	trmm_pool *pool = trmm_pool_shared();
+	openmp_simd_args args = {m0, n0, NULL, NULL, A_distributed, B_distributed, C_distributed};
+	args.schedule = openmp_simd_schedule_for(m0, n0, trmm_pool_size(pool));
+	if (args.schedule != NULL)
+		trmm_pool_run(pool, openmp_simd_numa_task, &args);
+
+	fprintf(stderr, "numa %d x %d: B %d/%d tiles remote, C %d/%d tiles remote, A tiles per node", m0, n0,
+		args.remote_B, args.tiles_B, args.remote_C, args.tiles_C);
+	for (int node = 0; node < NUMA_MAX_NODES; ++node)
+		if (A_tiles[node] > 0)
+			fprintf(stderr, " %d:%d", node, A_tiles[node]);
+	fprintf(stderr, "\n");
+}
+
+/*
+  Copies the column blocks of B the thread starts computing with, and its
+  share of the column blocks of A, into the distributed buffers.
+*/
+static void openmp_simd_distribute_task(void *data, int tid, int num_threads)
+{
+	openmp_simd_args *args = (openmp_simd_args *)data;
+	const int block_size = OPENMP_SIMD_BLOCK;
+	int m0 = args->m0;
+	int n0 = args->n0;
+	int ld = trmm_padded_ld(m0);
+	int begin, end;
+
+	trmm_pool_range((m0 + block_size - 1) / block_size, tid, num_threads, &begin, &end);
+	for (int p0 = begin * block_size; p0 < end * block_size; p0 += block_size)
+		layout_copy(m0, MIN(block_size, m0 - p0), &args->A_sequential[p0 * m0], m0, 1,
+			    &args->A_distributed[p0 * ld], ld, 1);
+
+	for (int j0 = 0; j0 < n0; j0 += block_size)
+		if (args->schedule->column_owner[j0 / block_size] == tid)
+			layout_copy(m0, MIN(block_size, n0 - j0), &args->B_sequential[j0 * m0], m0, 1,
+				    &args->B_distributed[j0 * ld], ld, 1);
+}
+
+void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		trmm_pool *pool = trmm_pool_shared();
+		openmp_simd_args args = {m0, n0, NULL, NULL, A_distributed, B_distributed, C_distributed};
+		args.schedule = openmp_simd_schedule_for(m0, n0, trmm_pool_size(pool));
+		if (args.schedule == NULL)
+		{
+			fprintf(stderr, "openMP_SIMD: out of memory for the tile schedule\n");
+			return;
+		}
+
+		// Every call starts from the same deal, only the deques are reset
+		ws_seed(args.schedule->queues, args.schedule->num_threads, args.schedule->ids, args.schedule->first);
+		trmm_pool_run(pool, openmp_simd_compute_task, &args);
+
+		// Once per shape
+		static int reported_m0 = -1;
+		static int reported_n0 = -1;
+		const char *report = getenv("TRMM_NUMA_REPORT");
+		if (report != NULL && atoi(report) > 0 && (m0 != reported_m0 || n0 != reported_n0))
+		{
+			openmp_simd_numa_report(m0, n0, A_distributed, B_distributed, C_distributed);
+			reported_m0 = m0;
+			reported_n0 = n0;
+		}
+	}
 	else
 	{
 		/* STUDENT_TODO: Modify this is you plan to use more
@@ -323,9 +647,9 @@ void DISTRIBUTED_ALLOCATE_NAME(int m0, int n0, float **A_distributed, float **B_
 	if (rid == root_rid)
 	{
 
-		*A_distributed = (float *)malloc(sizeof(float) * m0 * m0);
-		*C_distributed = (float *)malloc(sizeof(float) * m0 * n0);
-		*B_distributed = (float *)malloc(sizeof(float) * m0 * n0);
+		*A_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * m0);
+		*C_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * n0);
+		*B_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * n0);
 	}
 	else
 	{
@@ -361,13 +685,13 @@ void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequenti
 	// Note: Here is a perfect opportunity to change the layout
 	//       of your data which has the potential to give you
 	//       a sizeable performance gain.
-	// Layout for distributed data
+	// Layout for distributed data, columns padded by trmm_padded_ld()
 	// A is column major
-	int rs_AD = m0;
+	int rs_AD = trmm_padded_ld(m0);
 	int cs_AD = 1;
 
 	// B is column major
-	int rs_BD = m0;
+	int rs_BD = trmm_padded_ld(m0);
 	int cs_BD = 1;
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
@@ -375,19 +699,17 @@ void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequenti
 
 	if (rid == root_rid)
 	{
-		// Distribute the inputs
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int p0 = 0; p0 < m0; ++p0)
-			{
-				A_distributed[i0 * cs_AD + p0 * rs_AD] = A_sequential[i0 * cs_AS + p0 * rs_AS];
-			}
-
-		// Distribute the weights
-		for (int p0 = 0; p0 < m0; ++p0)
-			for (int j0 = 0; j0 < n0; ++j0)
-			{
-				B_distributed[p0 * cs_BD + j0 * rs_BD] = B_sequential[p0 * cs_BS + j0 * rs_BS];
-			}
+		// Distribute the inputs and the weights on the threads of compute
+		trmm_pool *pool = trmm_pool_shared();
+		openmp_simd_args args = {m0, n0, A_sequential, B_sequential, A_distributed, B_distributed, NULL};
+		args.schedule = openmp_simd_schedule_for(m0, n0, trmm_pool_size(pool));
+		if (args.schedule != NULL)
+			trmm_pool_run(pool, openmp_simd_distribute_task, &args);
+		else
+		{
+			layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
+			layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
+		}
 	}
 	else
 	{
@@ -422,9 +744,9 @@ void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential
 	// Note: Here is a perfect opportunity to change the layout
 	//       of your data which has the potential to give you
 	//       a sizeable performance gain.
-	// Layout for distributed data
+	// Layout for distributed data, columns padded by trmm_padded_ld()
 	// C is column major
-	int rs_CD = m0;
+	int rs_CD = trmm_padded_ld(m0);
 	int cs_CD = 1;
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
@@ -434,9 +756,7 @@ void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential
 	{
 
 		// Collect the output
-		for (int i0 = 0; i0 < m0; ++i0)
-			for (int j0 = 0; j0 < n0; ++j0)
-				C_sequential[i0 * cs_CS + j0 * rs_CS] = C_distributed[i0 * cs_CD + j0 * rs_CD];
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
 	}
 	else
 	{
@@ -470,9 +790,12 @@ void DISTRIBUTED_FREE_NAME(int m0, int n0, float *A_distributed, float *B_distri
 	if (rid == root_rid)
 	{
 
-		free(A_distributed);
-		free(B_distributed);
-		free(C_distributed);
+		trmm_free(A_distributed);
+		trmm_free(B_distributed);
+		trmm_free(C_distributed);
+
+		openmp_simd_schedule_destroy(tile_schedule);
+		tile_schedule = NULL;
 	}
 	else
 	{
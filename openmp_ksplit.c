@@ -0,0 +1,151 @@
+/*
+  k-split (p dimension) parallel TRMM for the openMP_X variants.
+
+  With the columns of C split over the threads, a tall shape with a handful
+  of columns (the harness default n0 = 3) gives most threads nothing to do.
+  Here every thread takes an equal range of p instead and accumulates
+
+    C[i, j] += A[i, p] * B[p, j],  i < j,  p in its range
+
+  into a private copy of the part of C that is written (rows below
+  min(n0 - 1, m0), all n0 columns), so no two threads ever add into the same
+  element. The copies are then summed pairwise in log2(threads) rounds, the
+  threads of a round working on different pairs, and the total is written
+  to the columns of C split with partition.c.
+
+  openmp_ksplit_wanted() picks this mode when the columns cannot keep the
+  threads busy (fewer than OPENMP_KSPLIT_COLUMNS per thread) and a private
+  copy is small enough to stay in cache (OPENMP_KSPLIT_MAX_TILE floats).
+  TRMM_KSPLIT=0 never uses it, TRMM_KSPLIT=1 always does when the copies
+  fit.
+*/
+
+#ifndef OPENMP_KSPLIT_C
+#define OPENMP_KSPLIT_C
+
+#include "partition.c"
+#include <omp.h>
+#include <stdlib.h>
+
+// -std=c99 hides posix_memalign()
+int posix_memalign(void **memptr, size_t alignment, size_t size);
+
+#ifndef OPENMP_KSPLIT_COLUMNS
+#define OPENMP_KSPLIT_COLUMNS 16
+#endif
+// 256 KB, an L2 slice on most machines
+#ifndef OPENMP_KSPLIT_MAX_TILE
+#define OPENMP_KSPLIT_MAX_TILE (64 * 1024)
+#endif
+// Private copies start on their own cache line
+#define OPENMP_KSPLIT_ALIGN 16
+
+// Rows of C below the diagonal part that is written
+static int openmp_ksplit_rows(int m0, int n0)
+{
+	int rows = n0 - 1 < m0 ? n0 - 1 : m0;
+	return rows > 0 ? rows : 0;
+}
+
+static int openmp_ksplit_wanted(int m0, int n0, int num_threads)
+{
+	static int mode = -2;
+
+	if (mode == -2)
+	{
+		const char *text = getenv("TRMM_KSPLIT");
+		mode = text != NULL ? atoi(text) > 0 : -1;
+	}
+
+	if (mode == 0 || num_threads < 2 || m0 < num_threads)
+		return 0;
+	if ((long)openmp_ksplit_rows(m0, n0) * n0 > OPENMP_KSPLIT_MAX_TILE)
+		return 0;
+	return mode == 1 || n0 < OPENMP_KSPLIT_COLUMNS * num_threads;
+}
+
+/*
+  C (column major, leading dimension m0) gets the i < j part of A B; the
+  other elements are left alone. Falls back to one thread if the private
+  copies cannot be allocated.
+*/
+static void openmp_ksplit_trmm(int m0, int n0, const float *A, const float *B, float *C, int num_threads)
+{
+	int rows = openmp_ksplit_rows(m0, n0);
+	if (rows == 0)
+		return;
+
+	long tile = ((long)rows * n0 + OPENMP_KSPLIT_ALIGN - 1) / OPENMP_KSPLIT_ALIGN * OPENMP_KSPLIT_ALIGN;
+	float *tiles = NULL;
+	if (posix_memalign((void **)&tiles, sizeof(float) * OPENMP_KSPLIT_ALIGN, sizeof(float) * tile * num_threads) != 0)
+	{
+		tiles = NULL;
+		num_threads = 1;
+	}
+
+#pragma omp parallel num_threads(num_threads)
+	{
+		int tid = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+
+		float *C_private = tiles != NULL ? &tiles[tid * tile] : NULL;
+		int ld = rows;
+		if (C_private == NULL)
+		{
+			// Single thread: accumulate straight into C
+			C_private = C;
+			ld = m0;
+		}
+
+		for (int j0 = 1; j0 < n0; ++j0)
+			for (int i0 = 0; i0 < (j0 < rows ? j0 : rows); ++i0)
+				C_private[i0 + j0 * ld] = 0.0f;
+
+		// Equal range of p, every p costs the same
+		int chunk = m0 / nt;
+		int extra = m0 % nt;
+		int p_begin = tid * chunk + (tid < extra ? tid : extra);
+		int p_end = p_begin + chunk + (tid < extra);
+
+		for (int j0 = 1; j0 < n0; ++j0)
+		{
+			int i_end = j0 < rows ? j0 : rows;
+			for (int p0 = p_begin; p0 < p_end; ++p0)
+			{
+				float B_pj = B[p0 + j0 * m0];
+				for (int i0 = 0; i0 < i_end; ++i0)
+					C_private[i0 + j0 * ld] += A[i0 + p0 * m0] * B_pj;
+			}
+		}
+
+		if (tiles != NULL)
+		{
+			// Pairwise sums into the copy of thread 0
+			for (int stride = 1; stride < nt; stride *= 2)
+			{
+#pragma omp barrier
+				if (tid % (2 * stride) == 0 && tid + stride < nt)
+				{
+					const float *other = &tiles[(tid + stride) * tile];
+					for (int j0 = 1; j0 < n0; ++j0)
+						for (int i0 = 0; i0 < (j0 < rows ? j0 : rows); ++i0)
+							C_private[i0 + j0 * ld] += other[i0 + j0 * ld];
+				}
+			}
+#pragma omp barrier
+
+			int j_begin, j_end;
+			partition_columns(m0, n0, 1, tid, nt, &j_begin, &j_end);
+			for (int j0 = j_begin; j0 < j_end; ++j0)
+			{
+				int i_end = j0 < rows ? j0 : rows;
+				for (int i0 = 0; i0 < i_end; ++i0)
+					C[i0 + j0 * m0] = tiles[i0 + j0 * rows];
+			}
+		}
+	}
+
+	free(tiles);
+}
+
+#endif // OPENMP_KSPLIT_C
@@ -0,0 +1,282 @@
+/*
+  This is the baseline implementation of a Triangular Matrix Times Matrix
+  Multiplication  (TRMM)
+
+  C = AB, where
+  A is an MxM lower triangular (A_{i,p} = 0 if p > i) Matrix. It is indexed by i0 and p0
+  B is an MxN matrix. It is indexed by p0 and j0.
+  C is an MxN matrix. It is indexed by i0 and j0.
+
+
+  Parameters:
+
+  m0 > 0: dimension
+  n0 > 0: dimension
+
+
+
+  float* A_sequential: pointer to original A matrix data
+  float* A_distributed: pointer to the input data that you have distributed across
+  the system
+
+  float* C_sequential:  pointer to original output data
+  float* C_distributed: pointer to the output data that you have distributed across
+  the system
+
+  float* B_sequential:  pointer to original weights data
+  float* B_distributed: pointer to the weights data that you have distributed across
+  the system
+
+  Functions:
+
+  DISTRIBUTED_ALLOCATE_NAME(...): Allocate the distributed buffers.
+  DISTRIBUTE_DATA_NAME(...): takes the sequential data and distributes it across the system.
+  COMPUTE_NAME(...): Performs the stencil computation.
+  COLLECT_DATA_NAME(...): Collect the distributed output and combine it back to the sequential
+  one for testing.
+  DISTRIBUTED_FREE_NAME(...): Free the distributed buffers that were allocated
+
+
+  - richard.m.veras@ou.edu
+
+*/
+
+#include "layout_copy.c"
+#include "packed_kernels.c"
+#include "packed_tuning.c"
+#include "triangular.c"
+#include "trmm_alloc.c"
+#include <immintrin.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef COMPUTE_NAME
+#define COMPUTE_NAME baseline
+#endif
+
+#ifndef DISTRIBUTE_DATA_NAME
+#define DISTRIBUTE_DATA_NAME baseline_distribute
+#endif
+
+#ifndef COLLECT_DATA_NAME
+#define COLLECT_DATA_NAME baseline_collect
+#endif
+
+#ifndef DISTRIBUTED_ALLOCATE_NAME
+#define DISTRIBUTED_ALLOCATE_NAME baseline_allocate
+#endif
+
+#ifndef DISTRIBUTED_FREE_NAME
+#define DISTRIBUTED_FREE_NAME baseline_free
+#endif
+
+void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		// Micro-kernel for this CPU, chosen on the first call
+		const packed_isa *isa = packed_select_isa();
+
+		// Blocking, loop order and threads for this shape from the tuning file
+		packed_params params = packed_tuned_params(isa, m0, n0);
+		params.lower_A = trmm_lower_A();
+
+		// Packing buffers for the MC x KC blocks of A and the KC x NC panels of B
+		float *A_packed = (float *)_mm_malloc(sizeof(float) * packed_A_size(&params), PACKED_ALIGN);
+		float *B_packed = (float *)_mm_malloc(sizeof(float) * packed_B_size(&params), PACKED_ALIGN);
+
+		// Leading dimension of the distributed buffers
+		int ld = trmm_padded_ld(m0);
+		packed_trmm_strided(isa, &params, m0, n0, A_distributed, ld, NULL, B_distributed, ld, C_distributed, ld,
+				    A_packed, B_packed);
+
+		_mm_free(A_packed);
+		_mm_free(B_packed);
+	}
+	else
+	{
+		/* STUDENT_TODO: Modify this is you plan to use more
+		 than 1 rank to do work in distributed memory context. */
+	}
+}
+
+// Create the buffers on each node
+void DISTRIBUTED_ALLOCATE_NAME(int m0, int n0, float **A_distributed, float **B_distributed, float **C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		*A_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * m0);
+		*C_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * n0);
+		*B_distributed = trmm_alloc((size_t)trmm_padded_ld(m0) * n0);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of its buffers allocated.
+		*/
+	}
+}
+
+void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequential, float *A_distributed,
+			  float *B_distributed)
+{
+
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	int rs_AS = m0;
+	int cs_AS = 1;
+
+	// B is column major
+	int rs_BS = m0;
+	int cs_BS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data, columns padded by trmm_padded_ld()
+	// A is column major
+	int rs_AD = trmm_padded_ld(m0);
+	int cs_AD = 1;
+
+	// B is column major
+	int rs_BD = trmm_padded_ld(m0);
+	int cs_BD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		// Distribute the inputs
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
+
+		// Distribute the weights
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of the necessary data for the computation.
+	      All other ranks have garbage in their data. This is where
+	      rank with rid == 0 needs to SEND data to the other nodes
+	      to RECEIVE the data, or use COLLECTIVE COMMUNICATION to
+	      distribute the data.
+		*/
+	}
+}
+
+void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	// C is column major
+	int rs_CS = m0;
+	int cs_CS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data, columns padded by trmm_padded_ld()
+	// C is column major
+	int rs_CD = trmm_padded_ld(m0);
+	int cs_CD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		// Collect the output
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 performs the computation and copies the
+	      "distributed" data to the "sequential" buffer that
+	      is checked by the verifier on rank rid == 0. If the
+	      other ranks contributed to the computation, then
+	      rank rid == 0 needs to RECEIVE the contributions that
+	      the other ranks SEND, or use COLLECTIVE COMMUNICATIONS
+	      for the same result.
+		*/
+	}
+}
+
+void DISTRIBUTED_FREE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		trmm_free(A_distributed);
+		trmm_free(B_distributed);
+		trmm_free(C_distributed);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 allocates the "distributed" buffers for itself.
+	      If the other ranks were modified to allocate their own
+	      buffers then they need to be freed at the end.
+		*/
+	}
+}
\ No newline at end of file
@@ -0,0 +1,768 @@
+/*
+  Packed-panel engine shared by the packed_* variants.
+
+  This follows the GotoBLAS/BLIS layering:
+
+  jc loop: NC columns of B/C   (B panel lives in L3)
+   pc loop: KC slice of p      (B panel is packed into NR column micro-panels)
+    ic loop: MC rows of A/C    (A block lives in L2, packed into MR row micro-panels)
+     macro_kernel: jr/ir loops over the MR x NR micro-tiles of C
+      micro_kernel: C(MR x NR) += A(MR x KC) * B(KC x NR) held in registers
+
+  Only the strictly upper part of C (i0 < j0) is written. Micro-tiles that sit
+  entirely on or below the diagonal are skipped, tiles fully above it are
+  updated in place, and tiles that straddle the diagonal (or the m0/n0 edge)
+  are computed into a small buffer and stored through the i0 < j0 mask.
+
+  All matrices are column major with a leading dimension of m0, just like the
+  other variants.
+
+  The cache blocks, the order of the jc/pc/ic loops and the thread count are
+  run time parameters (packed_params) so they can be tuned per shape, see
+  packed_tuning.c. Untuned shapes size the blocks from the L1/L2/L3 sizes of
+  the machine, see cache_info.c.
+
+  The micro-kernels are compiled per instruction set with target attributes,
+  so this file does not need -mavx2/-mfma/-mavx512f. packed_select_isa() picks
+  the best one the CPU supports on the first call. Set TRMM_ISA=sse|avx2|avx512
+  to force a specific path when benchmarking.
+*/
+
+#ifndef PACKED_KERNELS_C
+#define PACKED_KERNELS_C
+
+#include <immintrin.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache_info.c"
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+// Largest register block of any micro-kernel below. Sizes the edge buffer
+// and the padding of the packing buffers.
+#define PACKED_MR_MAX 32
+#define PACKED_NR_MAX 12
+
+// Alignment of the packing buffers, one cache line.
+#define PACKED_ALIGN 64
+
+// Orders of the three cache blocking loops
+#define PACKED_ORDER_JPI 0 // jc, pc, ic: packed B panel stays in L3, A blocks stream through L2
+#define PACKED_ORDER_IPJ 1 // ic, pc, jc: packed A block stays in L2, B panels stream past it
+
+typedef struct
+{
+	int mc;
+	int kc;
+	int nc;
+	int order;
+	int num_threads;
+	// Trust A_{i,p} = 0 for p > i and skip those blocks, see triangular.c
+	int lower_A;
+} packed_params;
+
+// Floats needed by the packing buffers of all threads, including the padding
+// of the last micro-panel. With PACKED_ORDER_IPJ every thread packs its own B.
+static size_t packed_A_size(const packed_params *params)
+{
+	return (size_t)(params->mc + PACKED_MR_MAX) * params->kc * params->num_threads;
+}
+
+static size_t packed_B_size(const packed_params *params)
+{
+	int num_B = params->order == PACKED_ORDER_IPJ ? params->num_threads : 1;
+	return (size_t)(params->nc + PACKED_NR_MAX) * params->kc * num_B;
+}
+
+// C(mr x nr) += A_packed(mr x kc) * B_packed(kc x nr), C column major with leading dimension ldc
+typedef void (*micro_kernel_fn)(int kc, const float *A_packed, const float *B_packed, float *C, int ldc);
+
+// Same update, but only rows ii < MIN(mr, diag + jj) of the first nr columns
+// of C are written. Used for the tiles on the diagonal and the matrix edge.
+typedef void (*micro_kernel_edge_fn)(int kc, const float *A_packed, const float *B_packed, float *C, int ldc, int mr,
+				     int nr, int diag);
+
+// One instruction set specific build of the micro-kernel and its register block.
+// edge_kernel is optional, without it edge tiles go through a buffer.
+typedef struct
+{
+	const char *name;
+	int mr;
+	int nr;
+	micro_kernel_fn kernel;
+	micro_kernel_edge_fn edge_kernel;
+} packed_isa;
+
+// Cache blocks sized from the caches of this machine for the register block
+// of isa, see cache_info.c. TRMM_MC, TRMM_KC and TRMM_NC override them.
+static packed_params packed_default_params(const packed_isa *isa)
+{
+	packed_params params;
+	cache_blocks(isa->mr, isa->nr, &params.mc, &params.kc, &params.nc);
+	params.order = PACKED_ORDER_JPI;
+	params.num_threads = omp_get_max_threads();
+	params.lower_A = 0;
+	return params;
+}
+
+/*
+  Pack the mc x kc block of A starting at A into MR row micro-panels.
+  Within a micro-panel the MR values of one column p0 are contiguous,
+  rows past mc are padded with zeros.
+*/
+static void pack_A(int MR, int mc, int kc, const float *A, int lda, float *A_packed)
+{
+	for (int ir = 0; ir < mc; ir += MR)
+	{
+		int mr = MIN(MR, mc - ir);
+		for (int p0 = 0; p0 < kc; ++p0)
+		{
+			const float *A_col = &A[ir + p0 * lda];
+			int ii = 0;
+			for (; ii < mr; ++ii)
+				A_packed[ii] = A_col[ii];
+			for (; ii < MR; ++ii)
+				A_packed[ii] = 0.0f;
+			A_packed += MR;
+		}
+	}
+}
+
+/*
+  Pack the kc x nc block of B starting at B into NR column micro-panels.
+  Within a micro-panel the NR values of one row p0 are contiguous,
+  columns past nc are padded with zeros.
+*/
+static void pack_B(int NR, int kc, int nc, const float *B, int ldb, float *B_packed)
+{
+	for (int jr = 0; jr < nc; jr += NR)
+	{
+		int nr = MIN(NR, nc - jr);
+		for (int p0 = 0; p0 < kc; ++p0)
+		{
+			int jj = 0;
+			for (; jj < nr; ++jj)
+				B_packed[jj] = B[p0 + (jr + jj) * ldb];
+			for (; jj < NR; ++jj)
+				B_packed[jj] = 0.0f;
+			B_packed += NR;
+		}
+	}
+}
+
+// One rank-1 update of the 16x6 AVX2 register tile.
+#define MICRO_KERNEL_AVX2_RANK1(_k_)                                                                                   \
+	{                                                                                                              \
+		__m256 a0 = _mm256_load_ps(&A_packed[(_k_) * 16]);                                                     \
+		__m256 a1 = _mm256_load_ps(&A_packed[(_k_) * 16 + 8]);                                                 \
+		__m256 b;                                                                                              \
+		b = _mm256_broadcast_ss(&B_packed[(_k_) * 6 + 0]);                                                     \
+		c00 = _mm256_fmadd_ps(a0, b, c00);                                                                     \
+		c10 = _mm256_fmadd_ps(a1, b, c10);                                                                     \
+		b = _mm256_broadcast_ss(&B_packed[(_k_) * 6 + 1]);                                                     \
+		c01 = _mm256_fmadd_ps(a0, b, c01);                                                                     \
+		c11 = _mm256_fmadd_ps(a1, b, c11);                                                                     \
+		b = _mm256_broadcast_ss(&B_packed[(_k_) * 6 + 2]);                                                     \
+		c02 = _mm256_fmadd_ps(a0, b, c02);                                                                     \
+		c12 = _mm256_fmadd_ps(a1, b, c12);                                                                     \
+		b = _mm256_broadcast_ss(&B_packed[(_k_) * 6 + 3]);                                                     \
+		c03 = _mm256_fmadd_ps(a0, b, c03);                                                                     \
+		c13 = _mm256_fmadd_ps(a1, b, c13);                                                                     \
+		b = _mm256_broadcast_ss(&B_packed[(_k_) * 6 + 4]);                                                     \
+		c04 = _mm256_fmadd_ps(a0, b, c04);                                                                     \
+		c14 = _mm256_fmadd_ps(a1, b, c14);                                                                     \
+		b = _mm256_broadcast_ss(&B_packed[(_k_) * 6 + 5]);                                                     \
+		c05 = _mm256_fmadd_ps(a0, b, c05);                                                                     \
+		c15 = _mm256_fmadd_ps(a1, b, c15);                                                                     \
+	}
+
+// Add one 16 row accumulator column into C.
+#define MICRO_KERNEL_AVX2_STORE_COL(_j_, _lo_, _hi_)                                                                   \
+	{                                                                                                              \
+		float *C_col = &C[(_j_) * ldc];                                                                        \
+		_mm256_storeu_ps(&C_col[0], _mm256_add_ps(_mm256_loadu_ps(&C_col[0]), _lo_));                          \
+		_mm256_storeu_ps(&C_col[8], _mm256_add_ps(_mm256_loadu_ps(&C_col[8]), _hi_));                          \
+	}
+
+/*
+  C(16 x 6) += A_packed(16 x kc) * B_packed(kc x 6)
+
+  The whole C tile stays in registers for the length of the p0 loop, which is
+  unrolled by 4. 16 rows are two __m256, so the 12 accumulators, 2 A vectors
+  and 1 broadcast B value fit in the 16 ymm registers.
+*/
+__attribute__((target("avx2,fma"))) static void micro_kernel_16x6_avx2(int kc, const float *A_packed,
+									 const float *B_packed, float *C, int ldc)
+{
+	__m256 c00 = _mm256_setzero_ps(), c10 = _mm256_setzero_ps();
+	__m256 c01 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+	__m256 c02 = _mm256_setzero_ps(), c12 = _mm256_setzero_ps();
+	__m256 c03 = _mm256_setzero_ps(), c13 = _mm256_setzero_ps();
+	__m256 c04 = _mm256_setzero_ps(), c14 = _mm256_setzero_ps();
+	__m256 c05 = _mm256_setzero_ps(), c15 = _mm256_setzero_ps();
+
+	int p0 = 0;
+	for (; p0 + 4 <= kc; p0 += 4)
+	{
+		MICRO_KERNEL_AVX2_RANK1(0);
+		MICRO_KERNEL_AVX2_RANK1(1);
+		MICRO_KERNEL_AVX2_RANK1(2);
+		MICRO_KERNEL_AVX2_RANK1(3);
+		A_packed += 4 * 16;
+		B_packed += 4 * 6;
+	}
+	for (; p0 < kc; ++p0)
+	{
+		MICRO_KERNEL_AVX2_RANK1(0);
+		A_packed += 16;
+		B_packed += 6;
+	}
+
+	MICRO_KERNEL_AVX2_STORE_COL(0, c00, c10);
+	MICRO_KERNEL_AVX2_STORE_COL(1, c01, c11);
+	MICRO_KERNEL_AVX2_STORE_COL(2, c02, c12);
+	MICRO_KERNEL_AVX2_STORE_COL(3, c03, c13);
+	MICRO_KERNEL_AVX2_STORE_COL(4, c04, c14);
+	MICRO_KERNEL_AVX2_STORE_COL(5, c05, c15);
+}
+
+// One rank-1 update of the 8x6 SSE register tile.
+#define MICRO_KERNEL_SSE_RANK1(_k_)                                                                                    \
+	{                                                                                                              \
+		__m128 a0 = _mm_load_ps(&A_packed[(_k_) * 8]);                                                         \
+		__m128 a1 = _mm_load_ps(&A_packed[(_k_) * 8 + 4]);                                                     \
+		__m128 b;                                                                                              \
+		b = _mm_load1_ps(&B_packed[(_k_) * 6 + 0]);                                                            \
+		c00 = _mm_add_ps(c00, _mm_mul_ps(a0, b));                                                              \
+		c10 = _mm_add_ps(c10, _mm_mul_ps(a1, b));                                                              \
+		b = _mm_load1_ps(&B_packed[(_k_) * 6 + 1]);                                                            \
+		c01 = _mm_add_ps(c01, _mm_mul_ps(a0, b));                                                              \
+		c11 = _mm_add_ps(c11, _mm_mul_ps(a1, b));                                                              \
+		b = _mm_load1_ps(&B_packed[(_k_) * 6 + 2]);                                                            \
+		c02 = _mm_add_ps(c02, _mm_mul_ps(a0, b));                                                              \
+		c12 = _mm_add_ps(c12, _mm_mul_ps(a1, b));                                                              \
+		b = _mm_load1_ps(&B_packed[(_k_) * 6 + 3]);                                                            \
+		c03 = _mm_add_ps(c03, _mm_mul_ps(a0, b));                                                              \
+		c13 = _mm_add_ps(c13, _mm_mul_ps(a1, b));                                                              \
+		b = _mm_load1_ps(&B_packed[(_k_) * 6 + 4]);                                                            \
+		c04 = _mm_add_ps(c04, _mm_mul_ps(a0, b));                                                              \
+		c14 = _mm_add_ps(c14, _mm_mul_ps(a1, b));                                                              \
+		b = _mm_load1_ps(&B_packed[(_k_) * 6 + 5]);                                                            \
+		c05 = _mm_add_ps(c05, _mm_mul_ps(a0, b));                                                              \
+		c15 = _mm_add_ps(c15, _mm_mul_ps(a1, b));                                                              \
+	}
+
+// Add one 8 row accumulator column into C.
+#define MICRO_KERNEL_SSE_STORE_COL(_j_, _lo_, _hi_)                                                                    \
+	{                                                                                                              \
+		float *C_col = &C[(_j_) * ldc];                                                                        \
+		_mm_storeu_ps(&C_col[0], _mm_add_ps(_mm_loadu_ps(&C_col[0]), _lo_));                                   \
+		_mm_storeu_ps(&C_col[4], _mm_add_ps(_mm_loadu_ps(&C_col[4]), _hi_));                                   \
+	}
+
+/*
+  C(8 x 6) += A_packed(8 x kc) * B_packed(kc x 6)
+
+  Baseline x86-64 fallback. Same shape as the AVX2 kernel at half the width,
+  12 accumulators in the 16 xmm registers and no FMA.
+*/
+static void micro_kernel_8x6_sse(int kc, const float *A_packed, const float *B_packed, float *C, int ldc)
+{
+	__m128 c00 = _mm_setzero_ps(), c10 = _mm_setzero_ps();
+	__m128 c01 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+	__m128 c02 = _mm_setzero_ps(), c12 = _mm_setzero_ps();
+	__m128 c03 = _mm_setzero_ps(), c13 = _mm_setzero_ps();
+	__m128 c04 = _mm_setzero_ps(), c14 = _mm_setzero_ps();
+	__m128 c05 = _mm_setzero_ps(), c15 = _mm_setzero_ps();
+
+	int p0 = 0;
+	for (; p0 + 4 <= kc; p0 += 4)
+	{
+		MICRO_KERNEL_SSE_RANK1(0);
+		MICRO_KERNEL_SSE_RANK1(1);
+		MICRO_KERNEL_SSE_RANK1(2);
+		MICRO_KERNEL_SSE_RANK1(3);
+		A_packed += 4 * 8;
+		B_packed += 4 * 6;
+	}
+	for (; p0 < kc; ++p0)
+	{
+		MICRO_KERNEL_SSE_RANK1(0);
+		A_packed += 8;
+		B_packed += 6;
+	}
+
+	MICRO_KERNEL_SSE_STORE_COL(0, c00, c10);
+	MICRO_KERNEL_SSE_STORE_COL(1, c01, c11);
+	MICRO_KERNEL_SSE_STORE_COL(2, c02, c12);
+	MICRO_KERNEL_SSE_STORE_COL(3, c03, c13);
+	MICRO_KERNEL_SSE_STORE_COL(4, c04, c14);
+	MICRO_KERNEL_SSE_STORE_COL(5, c05, c15);
+}
+
+/*
+  C(32 x 12) += A_packed(32 x kc) * B_packed(kc x 12) into the accumulators c.
+
+  32 rows are two __m512, so the 24 accumulators, 2 A vectors and 1 broadcast
+  B value use 27 of the 32 zmm registers. The fixed trip count loops are fully
+  unrolled so c never leaves the registers.
+*/
+__attribute__((target("avx512f"))) static inline void micro_kernel_32x12_avx512_acc(int kc, const float *A_packed,
+										      const float *B_packed,
+										      __m512 c[2][12])
+{
+#pragma GCC unroll 12
+	for (int jj = 0; jj < 12; ++jj)
+	{
+		c[0][jj] = _mm512_setzero_ps();
+		c[1][jj] = _mm512_setzero_ps();
+	}
+
+#pragma GCC unroll 2
+	for (int p0 = 0; p0 < kc; ++p0)
+	{
+		__m512 a0 = _mm512_load_ps(&A_packed[0]);
+		__m512 a1 = _mm512_load_ps(&A_packed[16]);
+#pragma GCC unroll 12
+		for (int jj = 0; jj < 12; ++jj)
+		{
+			__m512 b = _mm512_set1_ps(B_packed[jj]);
+			c[0][jj] = _mm512_fmadd_ps(a0, b, c[0][jj]);
+			c[1][jj] = _mm512_fmadd_ps(a1, b, c[1][jj]);
+		}
+		A_packed += 32;
+		B_packed += 12;
+	}
+}
+
+__attribute__((target("avx512f"))) static void micro_kernel_32x12_avx512(int kc, const float *A_packed,
+									   const float *B_packed, float *C, int ldc)
+{
+	__m512 c[2][12];
+	micro_kernel_32x12_avx512_acc(kc, A_packed, B_packed, c);
+
+#pragma GCC unroll 12
+	for (int jj = 0; jj < 12; ++jj)
+	{
+		float *C_col = &C[jj * ldc];
+		_mm512_storeu_ps(&C_col[0], _mm512_add_ps(_mm512_loadu_ps(&C_col[0]), c[0][jj]));
+		_mm512_storeu_ps(&C_col[16], _mm512_add_ps(_mm512_loadu_ps(&C_col[16]), c[1][jj]));
+	}
+}
+
+/*
+  Edge version of the 32x12 kernel. The i0 < j0 triangle and the m0/n0 edge
+  become one __mmask16 per 16 rows of each column, so the masked loads and
+  stores never touch C outside the tile.
+*/
+__attribute__((target("avx512f"))) static void micro_kernel_32x12_avx512_edge(int kc, const float *A_packed,
+										const float *B_packed, float *C, int ldc,
+										int mr, int nr, int diag)
+{
+	__m512 c[2][12];
+	micro_kernel_32x12_avx512_acc(kc, A_packed, B_packed, c);
+
+#pragma GCC unroll 12
+	for (int jj = 0; jj < 12; ++jj)
+	{
+		int rows = MIN(mr, diag + jj);
+		if (jj >= nr || rows <= 0)
+			continue;
+
+		__mmask16 k0 = (__mmask16)(rows >= 16 ? 0xFFFF : (1u << rows) - 1);
+		__mmask16 k1 = (__mmask16)(rows >= 32 ? 0xFFFF : rows <= 16 ? 0 : (1u << (rows - 16)) - 1);
+		float *C_col = &C[jj * ldc];
+		_mm512_mask_storeu_ps(&C_col[0], k0,
+				      _mm512_add_ps(_mm512_maskz_loadu_ps(k0, &C_col[0]), c[0][jj]));
+		_mm512_mask_storeu_ps(&C_col[16], k1,
+				      _mm512_add_ps(_mm512_maskz_loadu_ps(k1, &C_col[16]), c[1][jj]));
+	}
+}
+
+// Fastest first
+static const packed_isa packed_isa_table[] = {
+    {"avx512", 32, 12, micro_kernel_32x12_avx512, micro_kernel_32x12_avx512_edge},
+    {"avx2", 16, 6, micro_kernel_16x6_avx2, NULL},
+    {"sse", 8, 6, micro_kernel_8x6_sse, NULL},
+};
+
+#define PACKED_NUM_ISA ((int)(sizeof(packed_isa_table) / sizeof(packed_isa_table[0])))
+
+static int packed_isa_supported(const packed_isa *isa)
+{
+	if (strcmp(isa->name, "avx512") == 0)
+		return __builtin_cpu_supports("avx512f");
+	if (strcmp(isa->name, "avx2") == 0)
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	// SSE2 is part of x86-64
+	return 1;
+}
+
+// Entry of packed_isa_table called name, or NULL
+static const packed_isa *packed_isa_by_name(const char *name)
+{
+	for (int i = 0; i < PACKED_NUM_ISA; ++i)
+		if (strcmp(name, packed_isa_table[i].name) == 0)
+			return &packed_isa_table[i];
+	return NULL;
+}
+
+/*
+  Pick the micro-kernel on the first call and reuse it afterwards. TRMM_ISA
+  forces a path by name; if the name is unknown or the CPU cannot run it we
+  warn and fall back to the fastest supported one.
+*/
+static const packed_isa *packed_select_isa(void)
+{
+	static const packed_isa *selected = NULL;
+
+	if (selected != NULL)
+		return selected;
+
+	__builtin_cpu_init();
+
+	const char *forced = getenv("TRMM_ISA");
+	if (forced != NULL && forced[0] != '\0')
+	{
+		const packed_isa *isa = packed_isa_by_name(forced);
+		if (isa != NULL && packed_isa_supported(isa))
+			selected = isa;
+		else
+			fprintf(stderr, "TRMM_ISA=%s is %s, ignoring\n", forced,
+				isa != NULL ? "not supported on this CPU" : "unknown");
+	}
+
+	for (int i = 0; selected == NULL && i < PACKED_NUM_ISA; ++i)
+		if (packed_isa_supported(&packed_isa_table[i]))
+			selected = &packed_isa_table[i];
+
+	return selected;
+}
+
+/*
+  Multiply a packed mc x kc block of A with a packed kc x nc panel of B and
+  accumulate into C, which points at element (i_off, j_off) of the full
+  m0 x n0 output. i_off and j_off are needed to apply the i0 < j0 mask.
+*/
+static void macro_kernel(const packed_isa *isa, int mc, int nc, int kc, int i_off, int j_off, const float *A_packed,
+			 const float *B_packed, float *C, int ldc)
+{
+	float C_edge[PACKED_MR_MAX * PACKED_NR_MAX] __attribute__((aligned(PACKED_ALIGN)));
+	int MR = isa->mr;
+	int NR = isa->nr;
+
+	for (int jr = 0; jr < nc; jr += NR)
+	{
+		int nr = MIN(NR, nc - jr);
+		int j0 = j_off + jr;
+		const float *B_micro = &B_packed[jr * kc];
+
+		for (int ir = 0; ir < mc; ir += MR)
+		{
+			int mr = MIN(MR, mc - ir);
+			int i0 = i_off + ir;
+
+			// Every row is at or below every column: nothing to do here or
+			// in any of the remaining (lower) micro-tiles of this column.
+			if (i0 >= j0 + nr - 1)
+				break;
+
+			const float *A_micro = &A_packed[ir * kc];
+			float *C_micro = &C[ir + jr * ldc];
+
+			if (mr == MR && nr == NR && i0 + MR <= j0)
+			{
+				isa->kernel(kc, A_micro, B_micro, C_micro, ldc);
+			}
+			else if (isa->edge_kernel != NULL)
+			{
+				isa->edge_kernel(kc, A_micro, B_micro, C_micro, ldc, mr, nr, j0 - i0);
+			}
+			else
+			{
+				memset(C_edge, 0, sizeof(float) * MR * NR);
+				isa->kernel(kc, A_micro, B_micro, C_edge, MR);
+				for (int jj = 0; jj < nr; ++jj)
+				{
+					int ii_max = MIN(mr, j0 + jj - i0);
+					for (int ii = 0; ii < ii_max; ++ii)
+						C_micro[ii + jj * ldc] += C_edge[ii + jj * MR];
+				}
+			}
+		}
+	}
+}
+
+// Plain C += A_packed * B_packed with no i0 < j0 mask: offsets that put the
+// whole block above the diagonal turn macro_kernel into a GEMM.
+static void macro_kernel_gemm(const packed_isa *isa, int mc, int nc, int kc, const float *A_packed,
+			      const float *B_packed, float *C, int ldc)
+{
+	macro_kernel(isa, mc, nc, kc, 0, mc + PACKED_MR_MAX, A_packed, B_packed, C, ldc);
+}
+
+/*
+  Layout of a fully packed A: every MC x KC block the engine would pack,
+  ic blocks one after the other and the pc blocks of one ic block next to
+  each other, each padded to a multiple of MR rows. With it packed_trmm_cached()
+  skips packing A, which pays off when A stays the same over many calls.
+*/
+static size_t packed_A_cache_block_rows(const packed_isa *isa, const packed_params *params)
+{
+	return (size_t)(params->mc + isa->mr - 1) / isa->mr * isa->mr;
+}
+
+static size_t packed_A_cache_size(const packed_isa *isa, const packed_params *params, int m0, int n0)
+{
+	int m_eff = MIN(m0, n0 - 1);
+	if (m_eff <= 0)
+		return 0;
+	int num_blocks = (m_eff + params->mc - 1) / params->mc;
+	return num_blocks * packed_A_cache_block_rows(isa, params) * m0;
+}
+
+static const float *packed_A_cache_block(const packed_isa *isa, const packed_params *params, int m0, int ic, int pc,
+					 const float *A_cache)
+{
+	size_t rows = packed_A_cache_block_rows(isa, params);
+	return &A_cache[(ic / params->mc) * rows * m0 + rows * pc];
+}
+
+// Pack all of A into A_cache, which holds packed_A_cache_size() floats.
+static void packed_pack_A_cache(const packed_isa *isa, const packed_params *params, int m0, int n0, const float *A,
+				float *A_cache)
+{
+	int lda = m0;
+	int MC = params->mc;
+	int KC = params->kc;
+	int m_eff = MIN(m0, n0 - 1);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(params->num_threads)
+	for (int ic = 0; ic < m_eff; ic += MC)
+	{
+		int mc = MIN(MC, m_eff - ic);
+		for (int pc = 0; pc < m0; pc += KC)
+		{
+			int kc = MIN(KC, m0 - pc);
+			float *A_block = (float *)packed_A_cache_block(isa, params, m0, ic, pc, A_cache);
+			pack_A(isa->mr, mc, kc, &A[ic + pc * lda], lda, A_block);
+		}
+	}
+}
+
+// Leading rows of the block of A at (ic, pc) that are zero when params->lower_A
+// trusts A to be lower triangular, in whole MR micro-panels
+static int packed_lower_skip(const packed_params *params, int MR, int ic, int pc)
+{
+	if (!params->lower_A || pc <= ic)
+		return 0;
+	return (pc - ic) / MR * MR;
+}
+
+/*
+  C = A * B restricted to i0 < j0, with C zeroed everywhere else, using the
+  micro-kernel of isa and the blocking of params. A_packed must hold
+  packed_A_size(params) floats and B_packed packed_B_size(params) floats,
+  both aligned to PACKED_ALIGN.
+
+  The ic blocks are shared out dynamically between the threads since the
+  blocks near the top of C have more columns to the right of the diagonal.
+  Each thread packs into its own slice of A_packed. With PACKED_ORDER_JPI the
+  threads pack the B panel together and share it.
+
+  If A_cache is not NULL it holds A packed by packed_pack_A_cache() for the
+  same isa, params and shape; A and A_packed are not read then.
+
+  With params->lower_A the rows of each A block above the pc block (A is
+  zero there) are skipped in whole micro-panels, see packed_lower_skip(),
+  which leaves about half of the flops.
+
+  A, B and C are column major with leading dimensions lda, ldb and ldc
+  (at least m0). A_cache is laid out for lda = m0.
+*/
+static void packed_trmm_strided(const packed_isa *isa, const packed_params *params, int m0, int n0, const float *A,
+				int lda, const float *A_cache, const float *B, int ldb, float *C, int ldc,
+				float *A_packed, float *B_packed)
+{
+	int MC = params->mc;
+	int KC = params->kc;
+	int NC = params->nc;
+	int NR = isa->nr;
+
+	// Rows at or past the last column are never written.
+	int m_eff = MIN(m0, n0 - 1);
+
+	if (ldc == m0)
+		memset(C, 0, sizeof(float) * m0 * n0);
+	else
+		for (int j0 = 0; j0 < n0; ++j0)
+			memset(&C[(size_t)j0 * ldc], 0, sizeof(float) * m0);
+	if (m_eff <= 0)
+		return;
+
+#pragma omp parallel num_threads(params->num_threads) if (params->num_threads > 1)
+	{
+		int tid = omp_get_thread_num();
+		float *A_mine = &A_packed[(size_t)tid * (MC + PACKED_MR_MAX) * KC];
+
+		if (params->order == PACKED_ORDER_JPI)
+		{
+			for (int jc = 0; jc < n0; jc += NC)
+			{
+				int nc = MIN(NC, n0 - jc);
+				int m_panel = MIN(m0, jc + nc - 1);
+				if (m_panel <= 0)
+					continue;
+
+				for (int pc = 0; pc < m0; pc += KC)
+				{
+					int kc = MIN(KC, m0 - pc);
+
+#pragma omp for schedule(static)
+					for (int jr = 0; jr < nc; jr += NR)
+						pack_B(NR, kc, MIN(NR, nc - jr), &B[pc + (jc + jr) * ldb], ldb, &B_packed[jr * kc]);
+
+#pragma omp for schedule(dynamic, 1)
+					for (int ic = 0; ic < m_panel; ic += MC)
+					{
+						int mc = MIN(MC, m_panel - ic);
+						int skip = packed_lower_skip(params, isa->mr, ic, pc);
+						if (skip >= mc)
+							continue;
+
+						const float *A_block = A_mine;
+						if (A_cache != NULL)
+							A_block = packed_A_cache_block(isa, params, m0, ic, pc, A_cache) +
+								  (size_t)skip * kc;
+						else
+							pack_A(isa->mr, mc - skip, kc, &A[ic + skip + pc * lda], lda, A_mine);
+						macro_kernel(isa, mc - skip, nc, kc, ic + skip, jc, A_block, B_packed,
+							     &C[ic + skip + jc * ldc], ldc);
+					}
+				}
+			}
+		}
+		else
+		{
+			float *B_mine = &B_packed[(size_t)tid * (NC + PACKED_NR_MAX) * KC];
+
+#pragma omp for schedule(dynamic, 1)
+			for (int ic = 0; ic < m_eff; ic += MC)
+			{
+				int mc = MIN(MC, m_eff - ic);
+				int pc_end = params->lower_A ? MIN(m0, ic + mc) : m0;
+				for (int pc = 0; pc < pc_end; pc += KC)
+				{
+					int kc = MIN(KC, m0 - pc);
+					int skip = packed_lower_skip(params, isa->mr, ic, pc);
+					const float *A_block = A_mine;
+					if (A_cache != NULL)
+						A_block = packed_A_cache_block(isa, params, m0, ic, pc, A_cache) + (size_t)skip * kc;
+					else
+						pack_A(isa->mr, mc - skip, kc, &A[ic + skip + pc * lda], lda, A_mine);
+
+					// Columns up to ic + skip + 1 only meet rows at or below the diagonal
+					for (int jc = ic + skip + 1; jc < n0; jc += NC)
+					{
+						int nc = MIN(NC, n0 - jc);
+						pack_B(NR, kc, nc, &B[pc + jc * ldb], ldb, B_mine);
+						macro_kernel(isa, mc - skip, nc, kc, ic + skip, jc, A_block, B_mine,
+							     &C[ic + skip + jc * ldc], ldc);
+					}
+				}
+			}
+		}
+	}
+}
+
+static void packed_trmm_cached(const packed_isa *isa, const packed_params *params, int m0, int n0, const float *A,
+			       const float *A_cache, const float *B, float *C, float *A_packed, float *B_packed)
+{
+	packed_trmm_strided(isa, params, m0, n0, A, m0, A_cache, B, m0, C, m0, A_packed, B_packed);
+}
+
+static void packed_trmm(const packed_isa *isa, const packed_params *params, int m0, int n0, const float *A,
+			const float *B, float *C, float *A_packed, float *B_packed)
+{
+	packed_trmm_strided(isa, params, m0, n0, A, m0, NULL, B, m0, C, m0, A_packed, B_packed);
+}
+
+/*
+  In place version: B = A * B restricted to i0 < j0, zero elsewhere.
+
+  Column j0 of the result only reads column j0 of B, so B is processed in
+  panels of PACKED_INPLACE_NC columns: each panel is computed into
+  workspace (m0 x MIN(n0, PACKED_INPLACE_NC) floats, see
+  packed_inplace_size) with the JPI loops of packed_trmm_cached and then
+  copied over the panel of B.
+  Only that workspace is needed instead of a whole m0 x n0 C.
+*/
+// Narrower panels repack A more often, 256 loses about 15% against 512
+#define PACKED_INPLACE_NC 512
+
+static size_t packed_inplace_size(int m0, int n0)
+{
+	return (size_t)m0 * MIN(n0, PACKED_INPLACE_NC);
+}
+
+static void packed_trmm_inplace(const packed_isa *isa, const packed_params *params, int m0, int n0, const float *A,
+				float *B, float *A_packed, float *B_packed, float *workspace)
+{
+	int lda = m0;
+	int ldb = m0;
+	int ldw = m0;
+
+	int MC = params->mc;
+	int KC = params->kc;
+	int NC = MIN(params->nc, PACKED_INPLACE_NC);
+	int NR = isa->nr;
+
+#pragma omp parallel num_threads(params->num_threads) if (params->num_threads > 1)
+	{
+		float *A_mine = &A_packed[(size_t)omp_get_thread_num() * (MC + PACKED_MR_MAX) * KC];
+
+		for (int jc = 0; jc < n0; jc += NC)
+		{
+			int nc = MIN(NC, n0 - jc);
+			int m_panel = MIN(m0, jc + nc - 1);
+
+#pragma omp for schedule(static)
+			for (int jj = 0; jj < nc; ++jj)
+				memset(&workspace[jj * ldw], 0, sizeof(float) * m0);
+
+			for (int pc = 0; pc < m0 && m_panel > 0; pc += KC)
+			{
+				int kc = MIN(KC, m0 - pc);
+
+#pragma omp for schedule(static)
+				for (int jr = 0; jr < nc; jr += NR)
+					pack_B(NR, kc, MIN(NR, nc - jr), &B[pc + (jc + jr) * ldb], ldb, &B_packed[jr * kc]);
+
+#pragma omp for schedule(dynamic, 1)
+				for (int ic = 0; ic < m_panel; ic += MC)
+				{
+					int mc = MIN(MC, m_panel - ic);
+					int skip = packed_lower_skip(params, isa->mr, ic, pc);
+					if (skip >= mc)
+						continue;
+
+					pack_A(isa->mr, mc - skip, kc, &A[ic + skip + pc * lda], lda, A_mine);
+					macro_kernel(isa, mc - skip, nc, kc, ic + skip, jc, A_mine, B_packed, &workspace[ic + skip],
+						     ldw);
+				}
+			}
+
+			// Every read of this panel of B is done, overwrite it
+#pragma omp for schedule(static)
+			for (int jj = 0; jj < nc; ++jj)
+				memcpy(&B[(jc + jj) * ldb], &workspace[jj * ldw], sizeof(float) * m0);
+		}
+	}
+}
+
+#endif // PACKED_KERNELS_C
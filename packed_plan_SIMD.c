@@ -0,0 +1,297 @@
+/*
+  This is the baseline implementation of a Triangular Matrix Times Matrix
+  Multiplication  (TRMM)
+
+  C = AB, where
+  A is an MxM lower triangular (A_{i,p} = 0 if p > i) Matrix. It is indexed by i0 and p0
+  B is an MxN matrix. It is indexed by p0 and j0.
+  C is an MxN matrix. It is indexed by i0 and j0.
+
+
+  Parameters:
+
+  m0 > 0: dimension
+  n0 > 0: dimension
+
+
+
+  float* A_sequential: pointer to original A matrix data
+  float* A_distributed: pointer to the input data that you have distributed across
+  the system
+
+  float* C_sequential:  pointer to original output data
+  float* C_distributed: pointer to the output data that you have distributed across
+  the system
+
+  float* B_sequential:  pointer to original weights data
+  float* B_distributed: pointer to the weights data that you have distributed across
+  the system
+
+  Functions:
+
+  DISTRIBUTED_ALLOCATE_NAME(...): Allocate the distributed buffers.
+  DISTRIBUTE_DATA_NAME(...): takes the sequential data and distributes it across the system.
+  COMPUTE_NAME(...): Performs the stencil computation.
+  COLLECT_DATA_NAME(...): Collect the distributed output and combine it back to the sequential
+  one for testing.
+  DISTRIBUTED_FREE_NAME(...): Free the distributed buffers that were allocated
+
+
+  - richard.m.veras@ou.edu
+
+*/
+
+#include "layout_copy.c"
+#include "trmm_alloc.c"
+#include "trmm_batch.c"
+#include "trmm_plan.c"
+#include <immintrin.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef COMPUTE_NAME
+#define COMPUTE_NAME baseline
+#endif
+
+#ifndef DISTRIBUTE_DATA_NAME
+#define DISTRIBUTE_DATA_NAME baseline_distribute
+#endif
+
+#ifndef COLLECT_DATA_NAME
+#define COLLECT_DATA_NAME baseline_collect
+#endif
+
+#ifndef DISTRIBUTED_ALLOCATE_NAME
+#define DISTRIBUTED_ALLOCATE_NAME baseline_allocate
+#endif
+
+#ifndef DISTRIBUTED_FREE_NAME
+#define DISTRIBUTED_FREE_NAME baseline_free
+#endif
+
+#ifndef COMPUTE_BATCH_NAME
+#define COMPUTE_BATCH_NAME baseline_batch
+#endif
+
+/*
+  The plan for the last shape, created on the first call and kept until the
+  buffers are freed. Repeated calls with the same shape skip the MPI queries,
+  the micro-kernel and tuning lookups and the buffer allocation. With
+  TRMM_CACHE_A=1 they also skip packing A until it is distributed again.
+*/
+static trmm_plan *plan = NULL;
+
+void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+
+{
+	if (plan == NULL || plan->m0 != m0 || plan->n0 != n0)
+	{
+		trmm_plan_destroy(plan);
+		plan = trmm_plan_create(m0, n0, NULL);
+	}
+	if (plan == NULL)
+	{
+		fprintf(stderr, "packed_plan_SIMD: out of memory for the plan\n");
+		return;
+	}
+
+	trmm_execute(plan, A_distributed, B_distributed, C_distributed);
+}
+
+/*
+  batch_count independent problems of one shape, stored back to back:
+  entry b uses the m0 x m0 A at A_batch + b * m0 * m0 and the m0 x n0 B and C
+  at B_batch + b * m0 * n0 and C_batch + b * m0 * n0. Optional entry point,
+  timer_op.c uses it in its batch mode when the variant defines it.
+*/
+void COMPUTE_BATCH_NAME(int m0, int n0, int batch_count, float *A_batch, float *B_batch, float *C_batch)
+{
+	int rid;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+
+	if (rid == root_rid)
+	{
+		trmm_batch_strided(m0, n0, batch_count, A_batch, (long)m0 * m0, B_batch, (long)m0 * n0, C_batch,
+				   (long)m0 * n0);
+	}
+}
+
+// Create the buffers on each node
+void DISTRIBUTED_ALLOCATE_NAME(int m0, int n0, float **A_distributed, float **B_distributed, float **C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		*A_distributed = trmm_alloc((size_t)m0 * m0);
+		*C_distributed = trmm_alloc((size_t)m0 * n0);
+		*B_distributed = trmm_alloc((size_t)m0 * n0);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of its buffers allocated.
+		*/
+	}
+}
+
+void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequential, float *A_distributed,
+			  float *B_distributed)
+{
+
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	int rs_AS = m0;
+	int cs_AS = 1;
+
+	// B is column major
+	int rs_BS = m0;
+	int cs_BS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data
+	// A is column major
+	int rs_AD = m0;
+	int cs_AD = 1;
+
+	// B is column major
+	int rs_BD = m0;
+	int cs_BD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		// Distribute the inputs
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
+
+		// A_distributed has new contents, the packed copy is stale
+		if (plan != NULL)
+			trmm_plan_invalidate_A(plan);
+
+		// Distribute the weights
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of the necessary data for the computation.
+	      All other ranks have garbage in their data. This is where
+	      rank with rid == 0 needs to SEND data to the other nodes
+	      to RECEIVE the data, or use COLLECTIVE COMMUNICATION to
+	      distribute the data.
+		*/
+	}
+}
+
+void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	// C is column major
+	int rs_CS = m0;
+	int cs_CS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data
+	// C is column major
+	int rs_CD = m0;
+	int cs_CD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		// Collect the output
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 performs the computation and copies the
+	      "distributed" data to the "sequential" buffer that
+	      is checked by the verifier on rank rid == 0. If the
+	      other ranks contributed to the computation, then
+	      rank rid == 0 needs to RECEIVE the contributions that
+	      the other ranks SEND, or use COLLECTIVE COMMUNICATIONS
+	      for the same result.
+		*/
+	}
+}
+
+void DISTRIBUTED_FREE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	trmm_plan_destroy(plan);
+	plan = NULL;
+
+	if (rid == root_rid)
+	{
+
+		trmm_free(A_distributed);
+		trmm_free(B_distributed);
+		trmm_free(C_distributed);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 allocates the "distributed" buffers for itself.
+	      If the other ranks were modified to allocate their own
+	      buffers then they need to be freed at the end.
+		*/
+	}
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+/*
+  Tuning table for the packed engine.
+
+  run_tune_op.x sweeps the packed_params for a list of (m0, n0) shapes and
+  writes the winners to a csv file, one line per (isa, m0, n0):
+
+  isa,m0,n0,mc,kc,nc,order,num_threads,result
+
+  At run time packed_tuned_params() loads that file once (TRMM_TUNING_FILE,
+  default trmm_tuning.csv in the working directory) and returns the entry of
+  the running isa whose shape is closest to (m0, n0). Without a file, or
+  without an entry for the isa, the cache derived blocks of
+  packed_default_params() are used. TRMM_MC, TRMM_KC and TRMM_NC override the
+  blocks in both cases. Blocks from the file are rounded up the same way as
+  the overrides (see cache_info.c), and rows of an unknown isa are dropped.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKED_TUNING_FILE "trmm_tuning.csv"
+#define PACKED_TUNING_MAX_ENTRIES 512
+
+typedef struct
+{
+	char isa[16];
+	int m0;
+	int n0;
+	packed_params params;
+	float result;
+} packed_tuning_entry;
+
+typedef struct
+{
+	int num_entries;
+	packed_tuning_entry entries[PACKED_TUNING_MAX_ENTRIES];
+} packed_tuning_table;
+
+static const char *packed_tuning_file_name(void)
+{
+	const char *file_name = getenv("TRMM_TUNING_FILE");
+	if (file_name == NULL || file_name[0] == '\0')
+		file_name = PACKED_TUNING_FILE;
+	return file_name;
+}
+
+// Read a tuning file into table. Returns 0 if the file could not be opened.
+static int packed_tuning_load(const char *file_name, packed_tuning_table *table)
+{
+	table->num_entries = 0;
+
+	FILE *file = fopen(file_name, "r");
+	if (file == NULL)
+		return 0;
+
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL && table->num_entries < PACKED_TUNING_MAX_ENTRIES)
+	{
+		packed_tuning_entry *entry = &table->entries[table->num_entries];
+		packed_params *params = &entry->params;
+		params->lower_A = 0;
+
+		// The header and malformed lines do not parse and are skipped
+		if (sscanf(line, "%15[^,],%d,%d,%d,%d,%d,%d,%d,%f", entry->isa, &entry->m0, &entry->n0, &params->mc,
+			   &params->kc, &params->nc, &params->order, &params->num_threads, &entry->result) != 9)
+			continue;
+		if (params->mc <= 0 || params->kc <= 0 || params->nc <= 0 || params->num_threads <= 0)
+			continue;
+		if (params->order != PACKED_ORDER_JPI && params->order != PACKED_ORDER_IPJ)
+			continue;
+
+		// Hand edited blocks are rounded like the TRMM_MC/KC/NC overrides
+		const packed_isa *isa = packed_isa_by_name(entry->isa);
+		if (isa == NULL)
+			continue;
+		params->mc = cache_round_up(params->mc, isa->mr);
+		params->kc = cache_round_up(params->kc, CACHE_KC_STEP);
+		params->nc = cache_round_up(params->nc, isa->nr);
+		++table->num_entries;
+	}
+
+	fclose(file);
+	return 1;
+}
+
+static int packed_tuning_save(const char *file_name, const packed_tuning_table *table)
+{
+	FILE *file = fopen(file_name, "w");
+	if (file == NULL)
+	{
+		perror("Failed to open tuning file");
+		return 0;
+	}
+
+	fprintf(file, "isa,m0,n0,mc,kc,nc,order,num_threads,result\n");
+	for (int i = 0; i < table->num_entries; ++i)
+	{
+		const packed_tuning_entry *entry = &table->entries[i];
+		const packed_params *params = &entry->params;
+		fprintf(file, "%s,%i,%i,%i,%i,%i,%i,%i,%2.2f\n", entry->isa, entry->m0, entry->n0, params->mc, params->kc,
+			params->nc, params->order, params->num_threads, entry->result);
+	}
+
+	fclose(file);
+	return 1;
+}
+
+// Insert entry, replacing an existing one for the same isa and shape.
+static void packed_tuning_insert(packed_tuning_table *table, const packed_tuning_entry *entry)
+{
+	for (int i = 0; i < table->num_entries; ++i)
+	{
+		packed_tuning_entry *other = &table->entries[i];
+		if (strcmp(other->isa, entry->isa) == 0 && other->m0 == entry->m0 && other->n0 == entry->n0)
+		{
+			*other = *entry;
+			return;
+		}
+	}
+	if (table->num_entries < PACKED_TUNING_MAX_ENTRIES)
+		table->entries[table->num_entries++] = *entry;
+}
+
+// Ratio between two sizes, always >= 1
+static float packed_size_ratio(int a, int b)
+{
+	return a > b ? (float)a / b : (float)b / a;
+}
+
+/*
+  Parameters for an (m0, n0) problem on isa. The table is loaded on the first
+  call. Shapes are compared by the product of their m0 and n0 ratios, so the
+  nearest tuned shape on a log scale wins.
+*/
+static packed_params packed_tuned_params(const packed_isa *isa, int m0, int n0)
+{
+	static packed_tuning_table table;
+	static int loaded = 0;
+
+	if (!loaded)
+	{
+		packed_tuning_load(packed_tuning_file_name(), &table);
+		loaded = 1;
+	}
+
+	const packed_tuning_entry *best = NULL;
+	float best_distance = 0.0f;
+	for (int i = 0; i < table.num_entries; ++i)
+	{
+		const packed_tuning_entry *entry = &table.entries[i];
+		if (strcmp(entry->isa, isa->name) != 0)
+			continue;
+
+		float distance = packed_size_ratio(m0, entry->m0) * packed_size_ratio(n0, entry->n0);
+		if (best == NULL || distance < best_distance)
+		{
+			best = entry;
+			best_distance = distance;
+		}
+	}
+
+	if (best == NULL)
+		return packed_default_params(isa);
+
+	// The cache block overrides win over the table as well
+	packed_params params = best->params;
+	params.mc = cache_env_block("TRMM_MC", params.mc, isa->mr);
+	params.kc = cache_env_block("TRMM_KC", params.kc, CACHE_KC_STEP);
+	params.nc = cache_env_block("TRMM_NC", params.nc, isa->nr);
+	return params;
+}
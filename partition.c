@@ -0,0 +1,74 @@
+/*
+  Equal-flop split of the columns of C.
+
+  Column j of C gets an update for every row i < j (and i < m0), so its work
+  is m0 * min(j, m0) multiply-adds: an even split of [0, n0) gives the last
+  thread about twice the average work and the first almost none. The work
+  of the columns [0, j) has a closed form,
+
+    j <= m0:  j (j - 1) / 2
+    j >  m0:  m0 (m0 - 1) / 2 + (j - m0) m0      (times m0)
+
+  and partition_columns() cuts [0, n0) where that sum crosses k / parts of
+  the total. The cuts are rounded to a multiple of align (the SIMD width or
+  the tile size of the kernel) so no vector or tile straddles two threads;
+  the last one is always n0.
+
+  Each thread can compute its own range, no table needs to be shared:
+
+    int j_begin, j_end;
+    partition_columns(m0, n0, 16, tid, num_threads, &j_begin, &j_end);
+    for (int j0 = j_begin; j0 < j_end; ++j0)
+      ...
+*/
+
+#ifndef PARTITION_C
+#define PARTITION_C
+
+// Work of the columns [0, j), in units of m0 multiply-adds
+static double partition_column_work(int m0, int j)
+{
+	if (j <= m0)
+		return 0.5 * j * (j - 1.0);
+	return 0.5 * m0 * (m0 - 1.0) + (double)(j - m0) * m0;
+}
+
+// Smallest j in [0, n0] whose columns [0, j) do at least work
+static int partition_column_at(int m0, int n0, double work)
+{
+	int low = 0;
+	int high = n0;
+	while (low < high)
+	{
+		int mid = low + (high - low) / 2;
+		if (partition_column_work(m0, mid) < work)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+// Cut k of parts, rounded to the nearest multiple of align
+static int partition_column_cut(int m0, int n0, int align, int k, int parts)
+{
+	if (k <= 0)
+		return 0;
+	if (k >= parts)
+		return n0;
+
+	double work = partition_column_work(m0, n0) * k / parts;
+	int j = partition_column_at(m0, n0, work);
+	if (align > 1)
+		j = (j + align / 2) / align * align;
+	return j < n0 ? j : n0;
+}
+
+// [begin, end) of the columns of C for part of parts, align >= 1
+static void partition_columns(int m0, int n0, int align, int part, int parts, int *begin, int *end)
+{
+	*begin = partition_column_cut(m0, n0, align, part, parts);
+	*end = partition_column_cut(m0, n0, align, part + 1, parts);
+}
+
+#endif // PARTITION_C
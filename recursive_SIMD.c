@@ -0,0 +1,435 @@
+/*
+  This is the baseline implementation of a Triangular Matrix Times Matrix
+  Multiplication  (TRMM)
+
+  C = AB, where
+  A is an MxM lower triangular (A_{i,p} = 0 if p > i) Matrix. It is indexed by i0 and p0
+  B is an MxN matrix. It is indexed by p0 and j0.
+  C is an MxN matrix. It is indexed by i0 and j0.
+
+
+  Parameters:
+
+  m0 > 0: dimension
+  n0 > 0: dimension
+
+
+
+  float* A_sequential: pointer to original A matrix data
+  float* A_distributed: pointer to the input data that you have distributed across
+  the system
+
+  float* C_sequential:  pointer to original output data
+  float* C_distributed: pointer to the output data that you have distributed across
+  the system
+
+  float* B_sequential:  pointer to original weights data
+  float* B_distributed: pointer to the weights data that you have distributed across
+  the system
+
+  Functions:
+
+  DISTRIBUTED_ALLOCATE_NAME(...): Allocate the distributed buffers.
+  DISTRIBUTE_DATA_NAME(...): takes the sequential data and distributes it across the system.
+  COMPUTE_NAME(...): Performs the stencil computation.
+  COLLECT_DATA_NAME(...): Collect the distributed output and combine it back to the sequential
+  one for testing.
+  DISTRIBUTED_FREE_NAME(...): Free the distributed buffers that were allocated
+
+
+  - richard.m.veras@ou.edu
+
+*/
+
+#include "layout_copy.c"
+#include "packed_kernels.c"
+#include "trmm_alloc.c"
+#include <immintrin.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef COMPUTE_NAME
+#define COMPUTE_NAME baseline
+#endif
+
+#ifndef DISTRIBUTE_DATA_NAME
+#define DISTRIBUTE_DATA_NAME baseline_distribute
+#endif
+
+#ifndef COLLECT_DATA_NAME
+#define COLLECT_DATA_NAME baseline_collect
+#endif
+
+#ifndef DISTRIBUTED_ALLOCATE_NAME
+#define DISTRIBUTED_ALLOCATE_NAME baseline_allocate
+#endif
+
+#ifndef DISTRIBUTED_FREE_NAME
+#define DISTRIBUTED_FREE_NAME baseline_free
+#endif
+
+/*
+  Cache oblivious decomposition of the i0 < j0 iteration space.
+
+  The strict upper triangle of a diagonal block [lo, hi) splits at mid into
+
+  T(lo, mid)   triangle, recurse
+  T(mid, hi)   triangle, recurse
+  R            rows [lo, mid) x columns [mid, hi), a dense GEMM over all of p
+
+  and the dense blocks are halved along their largest dimension until all of
+  m, n and k fit RECURSIVE_BASE. Every level of the recursion then works on
+  blocks that are about half the size of the level above, so some level fits
+  each cache without knowing its size. The base blocks are packed and run
+  through the micro-kernels of packed_kernels.c.
+
+  All pieces of one split write disjoint parts of C (except the two halves of
+  a k split), so they run as OpenMP tasks.
+*/
+
+// Largest m, n and k of a base block. The packed A and B blocks of a base
+// block are 256 KB each. Smaller bases spend more time packing than the
+// micro-kernel saves.
+#define RECURSIVE_BASE 256
+
+// Blocks with fewer multiply-adds than this run in the task that found them
+#define RECURSIVE_TASK_MIN (1L << 21)
+
+typedef struct
+{
+	const packed_isa *isa;
+	int ld;
+	const float *A;
+	const float *B;
+	float *C;
+	// One pair of packing buffers per thread
+	float *A_packed;
+	float *B_packed;
+} recursive_ctx;
+
+#define RECURSIVE_A_SIZE ((RECURSIVE_BASE + PACKED_MR_MAX) * RECURSIVE_BASE)
+#define RECURSIVE_B_SIZE ((RECURSIVE_BASE + PACKED_NR_MAX) * RECURSIVE_BASE)
+
+// Where to split size so the first part is a multiple of step when possible
+static int recursive_split(int size, int step)
+{
+	int half = size / 2;
+	int split = half - half % step;
+	return split > 0 ? split : half;
+}
+
+/*
+  C(i0:i0+m, j0:j0+n) += A(i0:i0+m, p0:p0+k) * B(p0:p0+k, j0:j0+n) for a
+  block that fits RECURSIVE_BASE in m and n. With diag set only the
+  i0 < j0 entries of the block are written.
+
+  Runs inside one tied task with no scheduling points, so the packing
+  buffers of the current thread are safe to use.
+*/
+static void recursive_base(const recursive_ctx *ctx, int i0, int j0, int p0, int m, int n, int k, int diag)
+{
+	int tid = omp_get_thread_num();
+	float *A_packed = &ctx->A_packed[(size_t)tid * RECURSIVE_A_SIZE];
+	float *B_packed = &ctx->B_packed[(size_t)tid * RECURSIVE_B_SIZE];
+	int ld = ctx->ld;
+
+	for (int pc = p0; pc < p0 + k; pc += RECURSIVE_BASE)
+	{
+		int kc = MIN(RECURSIVE_BASE, p0 + k - pc);
+		pack_A(ctx->isa->mr, m, kc, &ctx->A[i0 + pc * ld], ld, A_packed);
+		pack_B(ctx->isa->nr, kc, n, &ctx->B[pc + j0 * ld], ld, B_packed);
+		if (diag)
+			macro_kernel(ctx->isa, m, n, kc, i0, j0, A_packed, B_packed, &ctx->C[i0 + j0 * ld], ld);
+		else
+			macro_kernel_gemm(ctx->isa, m, n, kc, A_packed, B_packed, &ctx->C[i0 + j0 * ld], ld);
+	}
+}
+
+// Dense C(i0:i0+m, j0:j0+n) += A(i0:i0+m, p0:p0+k) * B(p0:p0+k, j0:j0+n)
+static void recursive_gemm(const recursive_ctx *ctx, int i0, int j0, int p0, int m, int n, int k)
+{
+	if (m <= RECURSIVE_BASE && n <= RECURSIVE_BASE && k <= RECURSIVE_BASE)
+	{
+		recursive_base(ctx, i0, j0, p0, m, n, k, 0);
+		return;
+	}
+
+	int spawn = (long)m * n * k > RECURSIVE_TASK_MIN;
+
+	if (m >= n && m >= k)
+	{
+		int m1 = recursive_split(m, ctx->isa->mr);
+#pragma omp task if (spawn)
+		recursive_gemm(ctx, i0, j0, p0, m1, n, k);
+#pragma omp task if (spawn)
+		recursive_gemm(ctx, i0 + m1, j0, p0, m - m1, n, k);
+#pragma omp taskwait
+	}
+	else if (n >= k)
+	{
+		int n1 = recursive_split(n, ctx->isa->nr);
+#pragma omp task if (spawn)
+		recursive_gemm(ctx, i0, j0, p0, m, n1, k);
+#pragma omp task if (spawn)
+		recursive_gemm(ctx, i0, j0 + n1, p0, m, n - n1, k);
+#pragma omp taskwait
+	}
+	else
+	{
+		// Both halves update the same C, one after the other
+		int k1 = recursive_split(k, 8);
+		recursive_gemm(ctx, i0, j0, p0, m, n, k1);
+		recursive_gemm(ctx, i0, j0, p0 + k1, m, n, k - k1);
+	}
+}
+
+// i0 < j0 part of C(lo:hi, lo:hi) = A(lo:hi, :) * B(:, lo:hi)
+static void recursive_triangle(const recursive_ctx *ctx, int lo, int hi)
+{
+	int size = hi - lo;
+	if (size <= RECURSIVE_BASE)
+	{
+		recursive_base(ctx, lo, lo, 0, size, size, ctx->ld, 1);
+		return;
+	}
+
+	int mr = ctx->isa->mr;
+	int nr = ctx->isa->nr;
+	int mid = lo + recursive_split(size, mr * nr);
+
+	// Both triangles are about a quarter of the work of the rectangle
+	int spawn = (long)size * size * ctx->ld > 4 * RECURSIVE_TASK_MIN;
+
+#pragma omp task if (spawn)
+	recursive_gemm(ctx, lo, mid, 0, mid - lo, hi - mid, ctx->ld);
+#pragma omp task if (spawn)
+	recursive_triangle(ctx, lo, mid);
+#pragma omp task if (spawn)
+	recursive_triangle(ctx, mid, hi);
+#pragma omp taskwait
+}
+
+void COMPUTE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		int num_threads = omp_get_max_threads();
+
+		recursive_ctx ctx;
+		ctx.isa = packed_select_isa();
+		ctx.ld = m0;
+		ctx.A = A_distributed;
+		ctx.B = B_distributed;
+		ctx.C = C_distributed;
+		ctx.A_packed = (float *)_mm_malloc(sizeof(float) * RECURSIVE_A_SIZE * num_threads, PACKED_ALIGN);
+		ctx.B_packed = (float *)_mm_malloc(sizeof(float) * RECURSIVE_B_SIZE * num_threads, PACKED_ALIGN);
+
+		memset(C_distributed, 0, sizeof(float) * m0 * n0);
+
+		// Rows at or past n0 have no column to their right: the triangle ends at
+		// MIN(m0, n0) and columns past m0 are one dense block over all rows.
+		int n_tri = MIN(m0, n0);
+
+#pragma omp parallel num_threads(num_threads)
+#pragma omp single
+		{
+#pragma omp task
+			recursive_triangle(&ctx, 0, n_tri);
+			if (n0 > m0)
+			{
+#pragma omp task
+				recursive_gemm(&ctx, 0, m0, 0, m0, n0 - m0, m0);
+			}
+		}
+
+		_mm_free(ctx.A_packed);
+		_mm_free(ctx.B_packed);
+	}
+	else
+	{
+		/* STUDENT_TODO: Modify this is you plan to use more
+		 than 1 rank to do work in distributed memory context. */
+	}
+}
+
+// Create the buffers on each node
+void DISTRIBUTED_ALLOCATE_NAME(int m0, int n0, float **A_distributed, float **B_distributed, float **C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		*A_distributed = trmm_alloc((size_t)m0 * m0);
+		*C_distributed = trmm_alloc((size_t)m0 * n0);
+		*B_distributed = trmm_alloc((size_t)m0 * n0);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of its buffers allocated.
+		*/
+	}
+}
+
+void DISTRIBUTE_DATA_NAME(int m0, int n0, float *A_sequential, float *B_sequential, float *A_distributed,
+			  float *B_distributed)
+{
+
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	int rs_AS = m0;
+	int cs_AS = 1;
+
+	// B is column major
+	int rs_BS = m0;
+	int cs_BS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data
+	// A is column major
+	int rs_AD = m0;
+	int cs_AD = 1;
+
+	// B is column major
+	int rs_BD = m0;
+	int cs_BD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+		// Distribute the inputs
+		layout_copy(m0, m0, A_sequential, rs_AS, cs_AS, A_distributed, rs_AD, cs_AD);
+
+		// Distribute the weights
+		layout_copy(m0, n0, B_sequential, rs_BS, cs_BS, B_distributed, rs_BD, cs_BD);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 has all of the necessary data for the computation.
+	      All other ranks have garbage in their data. This is where
+	      rank with rid == 0 needs to SEND data to the other nodes
+	      to RECEIVE the data, or use COLLECTIVE COMMUNICATION to
+	      distribute the data.
+		*/
+	}
+}
+
+void COLLECT_DATA_NAME(int m0, int n0, float *C_distributed, float *C_sequential)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	// Layout for sequential data
+	// A is column major
+	// C is column major
+	int rs_CS = m0;
+	int cs_CS = 1;
+
+	// Note: Here is a perfect opportunity to change the layout
+	//       of your data which has the potential to give you
+	//       a sizeable performance gain.
+	// Layout for distributed data
+	// C is column major
+	int rs_CD = m0;
+	int cs_CD = 1;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		// Collect the output
+		layout_copy(m0, n0, C_distributed, rs_CD, cs_CD, C_sequential, rs_CS, cs_CS);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 performs the computation and copies the
+	      "distributed" data to the "sequential" buffer that
+	      is checked by the verifier on rank rid == 0. If the
+	      other ranks contributed to the computation, then
+	      rank rid == 0 needs to RECEIVE the contributions that
+	      the other ranks SEND, or use COLLECTIVE COMMUNICATIONS
+	      for the same result.
+		*/
+	}
+}
+
+void DISTRIBUTED_FREE_NAME(int m0, int n0, float *A_distributed, float *B_distributed, float *C_distributed)
+{
+	int rid;
+	int num_ranks;
+	int tag = 0;
+	MPI_Status status;
+	int root_rid = 0;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+	MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+	if (rid == root_rid)
+	{
+
+		trmm_free(A_distributed);
+		trmm_free(B_distributed);
+		trmm_free(C_distributed);
+	}
+	else
+	{
+		/*
+	      STUDENT_TODO: Modify this is you plan to use more
+	      than 1 rank to do work in distributed memory context.
+
+	      Note: In the original configuration only rank with
+	      rid == 0 allocates the "distributed" buffers for itself.
+	      If the other ranks were modified to allocate their own
+	      buffers then they need to be freed at the end.
+		*/
+	}
+}
\ No newline at end of file
@@ -0,0 +1,441 @@
+/*
+  Micro-benchmark of the ways threads can share the stores into C.
+
+  mutex_critical_section.c, mutex_lock.c and mutex_reduction.c each wrap
+  the C store in one kind of synchronization at a fixed thread count, and
+  the timer only shows the end result. This runs one and the same compute
+  under every strategy and thread count:
+
+  The work is the (j0, p-block) tasks of C[i, j] += A[i, p] B[p, j], i < j,
+  with p blocks of SYNC_KC. A task adds its partial sums for i < j into
+  column j of C, one update per element, so every strategy does the same
+  flops and the same number of updates:
+
+  none      k-split, plain +=. Races, timing reference only
+  critical  k-split, every update in #pragma omp critical
+  lock      k-split, every update under one omp_lock_t
+  atomic    k-split, compare and swap loop on the bits of the float
+  private   k-split into a private copy of C per thread, pairwise tree
+            reduction at the end (the scheme of openmp_ksplit.c)
+  owner     every thread owns whole columns (partition.c), plain +=
+
+  In the k-split strategies each thread takes an equal range of the p
+  blocks and sweeps all columns, so the threads meet on the same columns
+  of C the whole time.
+
+  Reported per strategy and thread count:
+
+  - result: flops / ns, the timer_op.c convention
+  - ns_per_update: time over the "none" run at the same thread count,
+    summed over the threads and divided by the number of updates, i.e. the
+    price of one synchronized update
+  - contention_ns: ns_per_update minus its value with one thread, the part
+    of that price that comes from other threads fighting over C
+  - retries: failed compare and swaps per update over the timed runs
+    (atomic only)
+  - max_diff: against the owner result, large for "none" when it races
+
+  usage: run_sync_bench_op.x min max step m0 n0 [result_file]
+
+  Thread counts are powers of two up to the number of OpenMP threads, plus
+  that number (OMP_NUM_THREADS).
+*/
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "partition.c"
+#include "timer.h"
+
+// p block of one task, one update of C per element and block
+#ifndef SYNC_KC
+#define SYNC_KC 64
+#endif
+
+enum
+{
+  SYNC_NONE,
+  SYNC_CRITICAL,
+  SYNC_LOCK,
+  SYNC_ATOMIC,
+  SYNC_PRIVATE,
+  SYNC_OWNER,
+  SYNC_NUM_STRATEGIES
+};
+
+static const char *sync_names[SYNC_NUM_STRATEGIES] = {
+  "none", "critical", "lock", "atomic", "private", "owner"};
+
+void fill_buffer_with_random( int num_elems, float *buff )
+{
+    for(int i = 0; i < num_elems; ++i)
+	buff[i] = ((float)(rand()-((RAND_MAX)/2)))/((float)RAND_MAX);
+}
+
+int scale_p_on_pos_ret_v_on_neg(int p, int v)
+{
+  if (v < 1)
+    return -1*v;
+  else
+    return v*p;
+}
+
+// Rows of C written in column j
+static int sync_rows(int m0, int j0)
+{
+  return j0 < m0 ? j0 : m0;
+}
+
+// C[i] += value with a compare and swap on the bits, returns the retries
+static long sync_atomic_add(float *target, float value)
+{
+  unsigned int *bits = (unsigned int *)target;
+  unsigned int expected = __atomic_load_n(bits, __ATOMIC_RELAXED);
+  long retries = 0;
+
+  for (;;)
+    {
+      float current;
+      memcpy(&current, &expected, sizeof(float));
+      float next = current + value;
+      unsigned int desired;
+      memcpy(&desired, &next, sizeof(float));
+
+      // On failure expected is reloaded with what another thread stored
+      if (__atomic_compare_exchange_n(bits, &expected, desired, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	return retries;
+      ++retries;
+    }
+}
+
+/*
+  Partial sums of one (j0, p block) task: sums[i] for i < rows of column j0.
+*/
+static void sync_task_sums(int m0, const float *A, const float *B,
+			   int j0, int p_begin, int p_end, float *sums)
+{
+  int rows = sync_rows(m0, j0);
+
+  for (int i0 = 0; i0 < rows; ++i0)
+    sums[i0] = 0.0f;
+  for (int p0 = p_begin; p0 < p_end; ++p0)
+    {
+      float B_pj = B[p0 + j0 * m0];
+      for (int i0 = 0; i0 < rows; ++i0)
+	sums[i0] += A[i0 + p0 * m0] * B_pj;
+    }
+}
+
+/*
+  C (column major, leading dimension m0) = the i < j part of A B, computed
+  with strategy on num_threads threads. Returns the failed compare and
+  swaps of the atomic strategy, 0 for the others.
+*/
+long sync_trmm(int strategy, int num_threads,
+	       int m0, int n0, const float *A, const float *B, float *C)
+{
+  int num_blocks = (m0 + SYNC_KC - 1) / SYNC_KC;
+  int rows_private = n0 - 1 < m0 ? n0 - 1 : m0;
+  long retries = 0;
+
+  omp_lock_t lock;
+  omp_init_lock(&lock);
+
+  // Private copies of the written part of C, a cache line apart
+  long tile = ((long)(rows_private > 0 ? rows_private : 0) * n0 + 15) / 16 * 16;
+  float *tiles = NULL;
+  if (strategy == SYNC_PRIVATE)
+    {
+      if (posix_memalign((void **)&tiles, 64, sizeof(float) * (tile > 0 ? tile : 1) * num_threads) != 0)
+	{
+	  printf("out of memory for %i private copies of C\n", num_threads);
+	  exit(1);
+	}
+    }
+
+  for (int j0 = 0; j0 < n0; ++j0)
+    for (int i0 = 0; i0 < m0; ++i0)
+      C[i0 + j0 * m0] = 0.0f;
+
+#pragma omp parallel num_threads(num_threads) reduction(+ : retries)
+  {
+    int tid = omp_get_thread_num();
+    int nt = omp_get_num_threads();
+    float *sums = (float *)malloc(sizeof(float) * (m0 > 0 ? m0 : 1));
+
+    float *target = C;
+    int ld = m0;
+    if (strategy == SYNC_PRIVATE)
+      {
+	target = &tiles[tid * tile];
+	ld = rows_private;
+	for (long k = 0; k < tile; ++k)
+	  target[k] = 0.0f;
+      }
+
+    // Columns and p blocks of this thread
+    int j_begin = 0, j_end = n0;
+    int b_begin = 0, b_end = num_blocks;
+    if (strategy == SYNC_OWNER)
+      partition_columns(m0, n0, 1, tid, nt, &j_begin, &j_end);
+    else
+      {
+	int chunk = num_blocks / nt;
+	int extra = num_blocks % nt;
+	b_begin = tid * chunk + (tid < extra ? tid : extra);
+	b_end = b_begin + chunk + (tid < extra);
+      }
+
+    for (int b = b_begin; b < b_end; ++b)
+      for (int j0 = j_begin; j0 < j_end; ++j0)
+	{
+	  int p_begin = b * SYNC_KC;
+	  int p_end = p_begin + SYNC_KC < m0 ? p_begin + SYNC_KC : m0;
+	  int rows = sync_rows(m0, j0);
+	  sync_task_sums(m0, A, B, j0, p_begin, p_end, sums);
+
+	  float *C_j = &target[j0 * ld];
+	  switch (strategy)
+	    {
+	    case SYNC_CRITICAL:
+	      for (int i0 = 0; i0 < rows; ++i0)
+		{
+#pragma omp critical
+		  C_j[i0] += sums[i0];
+		}
+	      break;
+	    case SYNC_LOCK:
+	      for (int i0 = 0; i0 < rows; ++i0)
+		{
+		  omp_set_lock(&lock);
+		  C_j[i0] += sums[i0];
+		  omp_unset_lock(&lock);
+		}
+	      break;
+	    case SYNC_ATOMIC:
+	      for (int i0 = 0; i0 < rows; ++i0)
+		retries += sync_atomic_add(&C_j[i0], sums[i0]);
+	      break;
+	    default:
+	      for (int i0 = 0; i0 < rows; ++i0)
+		C_j[i0] += sums[i0];
+	      break;
+	    }
+	}
+
+    if (strategy == SYNC_PRIVATE)
+      {
+	// Pairwise sums into the copy of thread 0, then out to C
+	for (int stride = 1; stride < nt; stride *= 2)
+	  {
+#pragma omp barrier
+	    if (tid % (2 * stride) == 0 && tid + stride < nt)
+	      {
+		const float *other = &tiles[(tid + stride) * tile];
+		for (long k = 0; k < (long)rows_private * n0; ++k)
+		  target[k] += other[k];
+	      }
+	  }
+#pragma omp barrier
+
+	int c_begin, c_end;
+	partition_columns(m0, n0, 1, tid, nt, &c_begin, &c_end);
+	for (int j0 = c_begin; j0 < c_end; ++j0)
+	  for (int i0 = 0; i0 < sync_rows(m0, j0); ++i0)
+	    C[i0 + j0 * m0] = tiles[i0 + j0 * rows_private];
+      }
+
+    free(sums);
+  }
+
+  free(tiles);
+  omp_destroy_lock(&lock);
+  return retries;
+}
+
+// Updates of C one run makes, the same for every strategy
+long sync_num_updates(int m0, int n0)
+{
+  long updates = 0;
+  for (int j0 = 0; j0 < n0; ++j0)
+    updates += sync_rows(m0, j0);
+  return updates * ((m0 + SYNC_KC - 1) / SYNC_KC);
+}
+
+// Best of num_trials runs in nanoseconds, retries summed over those runs
+long time_strategy(int strategy, int num_threads, int num_trials,
+		   int m0, int n0, const float *A, const float *B, float *C,
+		   long *retries)
+{
+  TIMER_INIT_COUNTERS(stop, start);
+  TIMER_WARMUP(stop, start);
+
+  // Untimed run to fault in the buffers and wake up the threads
+  sync_trmm(strategy, num_threads, m0, n0, A, B, C);
+
+  *retries = 0;
+
+  long best = -1;
+  for( int trial = 0; trial < num_trials; ++trial )
+    {
+      long elapsed;
+
+      TIMER_GET_CLOCK(start);
+      *retries += sync_trmm(strategy, num_threads, m0, n0, A, B, C);
+      TIMER_GET_CLOCK(stop);
+      TIMER_GET_DIFF(start, stop, elapsed);
+
+      if( best < 0 || elapsed < best )
+	best = elapsed;
+    }
+
+  return best;
+}
+
+int main( int argc, char *argv[] )
+{
+  int rid;
+  int num_ranks;
+  int root_rid = 0;
+
+  MPI_Init(&argc,&argv);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+  MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+  // The per update costs are differences of two timings, take a few more
+  int num_trials = 5;
+
+  // Problem parameters
+  int min_size;
+  int max_size;
+  int step_size;
+
+  int in_m0;
+  int in_n0;
+
+  FILE *result_file = NULL;
+
+  // Get command line arguments
+  if(argc == 5 + 1 || argc == 6 + 1 )
+    {
+      min_size  = atoi(argv[1]);
+      max_size  = atoi(argv[2]);
+      step_size = atoi(argv[3]);
+
+      in_m0=atoi(argv[4]);
+      in_n0=atoi(argv[5]);
+
+      if(argc == 6 + 1 && rid == root_rid)
+	{
+	  result_file = fopen(argv[6],"w");
+	  if(result_file == NULL)
+	    {
+	      printf("cannot open %s\n", argv[6]);
+	      exit(1);
+	    }
+	}
+    }
+  else
+    {
+      printf("usage: %s min max step m0 n0 [result_file]\n",
+	     argv[0]);
+      exit(1);
+    }
+
+  // Only the root rank computes, as in the variants
+  if( rid == root_rid )
+    {
+      // Powers of two up to the number of OpenMP threads, plus that number
+      int max_threads = omp_get_max_threads();
+      int thread_counts[32];
+      int num_thread_counts = 0;
+      for( int t = 1; t < max_threads && num_thread_counts < 31; t *= 2 )
+	thread_counts[num_thread_counts++] = t;
+      thread_counts[num_thread_counts++] = max_threads;
+
+      const char *header = "strategy,num_threads,m0,n0,updates,result,ns_per_update,contention_ns,retries,max_diff\n";
+      printf("%s", header);
+      if(result_file != NULL)
+	fprintf(result_file, "%s", header);
+
+      for( int p = min_size;
+	   p < max_size;
+	   p += step_size )
+	{
+	  int m0=scale_p_on_pos_ret_v_on_neg(p,in_m0);
+	  int n0=scale_p_on_pos_ret_v_on_neg(p,in_n0);
+
+	  float *A = (float *)malloc(sizeof(float)*m0*m0);
+	  float *B = (float *)malloc(sizeof(float)*m0*n0);
+	  float *C = (float *)malloc(sizeof(float)*m0*n0);
+	  float *C_ref = (float *)malloc(sizeof(float)*m0*n0);
+
+	  fill_buffer_with_random( m0*m0, A );
+	  fill_buffer_with_random( m0*n0, B );
+
+	  sync_trmm(SYNC_OWNER, 1, m0, n0, A, B, C_ref);
+
+	  long updates = sync_num_updates(m0, n0);
+	  // Same flop count convention as timer_op.c
+	  long num_flops = (long)m0*m0*n0;
+
+	  // ns_per_update with one thread, per strategy
+	  double single_ns[SYNC_NUM_STRATEGIES];
+
+	  for( int t = 0; t < num_thread_counts; ++t )
+	    {
+	      int num_threads = thread_counts[t];
+	      long retries;
+	      long reference = time_strategy(SYNC_NONE, num_threads, num_trials, m0, n0, A, B, C, &retries);
+
+	      for( int s = 0; s < SYNC_NUM_STRATEGIES; ++s )
+		{
+		  long elapsed = s == SYNC_NONE ? reference :
+		    time_strategy(s, num_threads, num_trials, m0, n0, A, B, C, &retries);
+
+		  // C still holds the result of the last timed run
+		  float max_diff = 0.0f;
+		  for( int k = 0; k < m0*n0; ++k )
+		    {
+		      float diff = fabsf(C[k] - C_ref[k]);
+		      if( diff > max_diff )
+			max_diff = diff;
+		    }
+
+		  double ns_per_update = updates > 0 ?
+		    (double)(elapsed - reference) * num_threads / updates : 0.0;
+		  if( num_threads == 1 )
+		    single_ns[s] = ns_per_update;
+
+		  char line[256];
+		  snprintf(line, sizeof(line), "%s,%i,%i,%i,%li,%2.2f,%2.3f,%2.3f,%2.3f,%g\n",
+			   sync_names[s], num_threads, m0, n0, updates,
+			   num_flops / ((float)elapsed),
+			   ns_per_update,
+			   ns_per_update - single_ns[s],
+			   s == SYNC_ATOMIC && updates > 0 ? (double)retries / ((double)num_trials * updates) : 0.0,
+			   max_diff);
+		  printf("%s", line);
+		  if(result_file != NULL)
+		    fprintf(result_file, "%s", line);
+		}
+	    }
+
+	  free(A);
+	  free(B);
+	  free(C);
+	  free(C_ref);
+	}
+    }
+  else
+    {/* all other nodes */}
+
+  if(result_file != NULL)
+    fclose(result_file);
+
+  MPI_Finalize();
+}
@@ -0,0 +1,308 @@
+/*
+  Persistent pool of pinned worker threads.
+
+  trmm_pool_run(pool, task, arg) runs task(arg, tid, num_threads) once on
+  every thread of the pool, the caller being tid 0, and returns when all of
+  them are done. The workers stay alive between runs, so a call does not
+  create or wake up a team the way an OpenMP parallel region can:
+
+  - idle workers spin on a generation counter for TRMM_POOL_SPIN pause
+    iterations and only then sleep on a condition variable, so back to back
+    runs (the timing loop calling COMPUTE_NAME) find them spinning
+  - the caller waits for the last worker the same way
+  - with more threads than allowed cpus nobody spins, a spinning thread
+    would only hold up the one it waits for
+
+  Worker t is pinned to the t-th cpu of the allowed cpuset of the process,
+  so a thread index keeps its core (and NUMA node) from run to run. The
+  caller is left where it is.
+
+  The size is TRMM_NUM_THREADS, or the number of cpus in the allowed cpuset
+  (taskset, the slurm allocation). trmm_pool_shared() is one pool of that
+  size for the whole process; trmm_pool_create() makes a pool of a given
+  size for an owner that wants its own.
+*/
+
+#ifndef THREAD_POOL_C
+#define THREAD_POOL_C
+
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+
+// -std=c99 hides syscall() and the cpu_set_t helpers
+long syscall(long number, ...);
+
+#ifndef TRMM_POOL_SPIN
+#define TRMM_POOL_SPIN (1 << 14)
+#endif
+#define TRMM_POOL_MAX_CPUS 1024
+
+typedef void (*trmm_pool_task)(void *arg, int tid, int num_threads);
+
+typedef struct trmm_pool trmm_pool;
+
+typedef struct
+{
+	trmm_pool *pool;
+	int tid;
+	int cpu;
+} trmm_pool_worker;
+
+struct trmm_pool
+{
+	int num_threads;
+	// Pause iterations before a wait sleeps
+	int spin;
+	pthread_t *threads;
+	trmm_pool_worker *workers;
+
+	// Current task, published by bumping generation
+	trmm_pool_task task;
+	void *arg;
+	unsigned long generation;
+	int stop;
+
+	// Workers still running the current task
+	int remaining;
+
+	// Sleeping side of the spin-then-sleep waits
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	int sleeping_workers;
+	int caller_sleeping;
+};
+
+typedef struct
+{
+	unsigned long bits[TRMM_POOL_MAX_CPUS / (8 * sizeof(unsigned long))];
+} trmm_cpu_mask;
+
+// Allowed cpus of the process, 0 if unknown
+static int trmm_allowed_cpus(trmm_cpu_mask *mask)
+{
+	// The kernel only writes as many bytes as its own mask has
+	memset(mask->bits, 0, sizeof(mask->bits));
+	long bytes = syscall(SYS_sched_getaffinity, 0, sizeof(mask->bits), mask->bits);
+	if (bytes <= 0)
+		return 0;
+
+	int count = 0;
+	for (int cpu = 0; cpu < TRMM_POOL_MAX_CPUS; ++cpu)
+		count += (mask->bits[cpu / (8 * sizeof(unsigned long))] >> (cpu % (8 * sizeof(unsigned long)))) & 1;
+	return count;
+}
+
+// TRMM_NUM_THREADS, else the size of the allowed cpuset
+static int trmm_pool_default_threads(void)
+{
+	const char *text = getenv("TRMM_NUM_THREADS");
+	if (text != NULL && atoi(text) > 0)
+		return atoi(text);
+
+	trmm_cpu_mask mask;
+	int count = trmm_allowed_cpus(&mask);
+	return count > 0 ? count : 1;
+}
+
+static int trmm_pool_spin(void)
+{
+	static int spin = -1;
+
+	if (spin < 0)
+	{
+		const char *text = getenv("TRMM_POOL_SPIN");
+		spin = text != NULL && atoi(text) >= 0 ? atoi(text) : TRMM_POOL_SPIN;
+	}
+	return spin;
+}
+
+static void *trmm_pool_worker_main(void *data)
+{
+	trmm_pool_worker *worker = (trmm_pool_worker *)data;
+	trmm_pool *pool = worker->pool;
+
+	if (worker->cpu >= 0)
+	{
+		trmm_cpu_mask mask = {{0}};
+		mask.bits[worker->cpu / (8 * sizeof(unsigned long))] |= 1UL << (worker->cpu % (8 * sizeof(unsigned long)));
+		syscall(SYS_sched_setaffinity, 0, sizeof(mask.bits), mask.bits);
+	}
+
+	unsigned long seen = 0;
+	for (;;)
+	{
+		// Wait for the next generation: spin first, then sleep
+		for (int s = 0; s < pool->spin && __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) == seen; ++s)
+			_mm_pause();
+		if (__atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) == seen)
+		{
+			pthread_mutex_lock(&pool->lock);
+			__atomic_add_fetch(&pool->sleeping_workers, 1, __ATOMIC_SEQ_CST);
+			while (__atomic_load_n(&pool->generation, __ATOMIC_SEQ_CST) == seen)
+				pthread_cond_wait(&pool->wake, &pool->lock);
+			__atomic_sub_fetch(&pool->sleeping_workers, 1, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&pool->lock);
+		}
+		seen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+
+		if (pool->stop)
+			return NULL;
+
+		pool->task(pool->arg, worker->tid, pool->num_threads);
+
+		// The last one out wakes the caller if it went to sleep
+		if (__atomic_sub_fetch(&pool->remaining, 1, __ATOMIC_SEQ_CST) == 0 &&
+		    __atomic_load_n(&pool->caller_sleeping, __ATOMIC_SEQ_CST))
+		{
+			pthread_mutex_lock(&pool->lock);
+			pthread_cond_signal(&pool->done);
+			pthread_mutex_unlock(&pool->lock);
+		}
+	}
+}
+
+// Publish the task (or stop) to the workers
+static void trmm_pool_publish(trmm_pool *pool)
+{
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&pool->sleeping_workers, __ATOMIC_SEQ_CST) > 0)
+	{
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static void trmm_pool_destroy(trmm_pool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	pool->stop = 1;
+	trmm_pool_publish(pool);
+	for (int t = 1; t < pool->num_threads; ++t)
+		pthread_join(pool->threads[t], NULL);
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->wake);
+	pthread_cond_destroy(&pool->done);
+	free(pool->threads);
+	free(pool->workers);
+	free(pool);
+}
+
+// num_threads <= 0 for trmm_pool_default_threads(). NULL if the threads
+// cannot be started.
+static trmm_pool *trmm_pool_create(int num_threads)
+{
+	if (num_threads <= 0)
+		num_threads = trmm_pool_default_threads();
+
+	trmm_pool *pool = (trmm_pool *)calloc(1, sizeof(trmm_pool));
+	if (pool == NULL)
+		return NULL;
+	pool->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+	pool->workers = (trmm_pool_worker *)calloc(num_threads, sizeof(trmm_pool_worker));
+	if (pool->threads == NULL || pool->workers == NULL)
+	{
+		free(pool->threads);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	// Pin worker t to the t-th allowed cpu, round robin if there are fewer
+	trmm_cpu_mask mask;
+	int num_cpus = trmm_allowed_cpus(&mask);
+	pool->spin = num_threads <= num_cpus ? trmm_pool_spin() : 0;
+	int cpu = -1;
+	for (int t = 0; t < num_threads; ++t)
+	{
+		pool->workers[t].pool = pool;
+		pool->workers[t].tid = t;
+		pool->workers[t].cpu = -1;
+		if (num_cpus <= 0)
+			continue;
+		do
+			cpu = (cpu + 1) % TRMM_POOL_MAX_CPUS;
+		while (!((mask.bits[cpu / (8 * sizeof(unsigned long))] >> (cpu % (8 * sizeof(unsigned long)))) & 1));
+		pool->workers[t].cpu = cpu;
+	}
+
+	// The caller is tid 0, the others get a thread each
+	pool->num_threads = 1;
+	for (int t = 1; t < num_threads; ++t)
+	{
+		if (pthread_create(&pool->threads[t], NULL, trmm_pool_worker_main, &pool->workers[t]) != 0)
+		{
+			trmm_pool_destroy(pool);
+			return NULL;
+		}
+		pool->num_threads = t + 1;
+	}
+	return pool;
+}
+
+// One pool of trmm_pool_default_threads() for the process, NULL if it
+// cannot be started
+static trmm_pool *trmm_pool_shared(void)
+{
+	static trmm_pool *pool = NULL;
+
+	if (pool == NULL)
+		pool = trmm_pool_create(0);
+	return pool;
+}
+
+// Threads a run of pool uses, 1 for a NULL pool
+static int trmm_pool_size(const trmm_pool *pool)
+{
+	return pool != NULL ? pool->num_threads : 1;
+}
+
+static void trmm_pool_run(trmm_pool *pool, trmm_pool_task task, void *arg)
+{
+	if (pool == NULL || pool->num_threads == 1)
+	{
+		task(arg, 0, 1);
+		return;
+	}
+
+	pool->task = task;
+	pool->arg = arg;
+	__atomic_store_n(&pool->remaining, pool->num_threads - 1, __ATOMIC_SEQ_CST);
+	trmm_pool_publish(pool);
+
+	task(arg, 0, pool->num_threads);
+
+	// Wait for the workers: spin first, then sleep
+	for (int s = 0; s < pool->spin && __atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) > 0; ++s)
+		_mm_pause();
+	if (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) > 0)
+	{
+		pthread_mutex_lock(&pool->lock);
+		__atomic_store_n(&pool->caller_sleeping, 1, __ATOMIC_SEQ_CST);
+		while (__atomic_load_n(&pool->remaining, __ATOMIC_SEQ_CST) > 0)
+			pthread_cond_wait(&pool->done, &pool->lock);
+		__atomic_store_n(&pool->caller_sleeping, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+// [begin, end) of count items for thread tid, contiguous like schedule(static)
+static void trmm_pool_range(int count, int tid, int num_threads, int *begin, int *end)
+{
+	int chunk = count / num_threads;
+	int extra = count % num_threads;
+	*begin = tid * chunk + (tid < extra ? tid : extra);
+	*end = *begin + chunk + (tid < extra);
+}
+
+#endif // THREAD_POOL_C
@@ -0,0 +1,64 @@
+/*
+  TRMM on the tile-contiguous layout of tiled_layout.c.
+
+  C = A * B restricted to i0 < j0 (C zero elsewhere) for m0 x m0 A and
+  m0 x n0 B and C:
+
+  A  tile layout rs = 1, cs = mt   TILED_ROW_PANELS of isa->mr rows
+  B  tile layout rs = mt, cs = 1   TILED_COL_PANELS of isa->nr columns
+  C  block packed upper triangle   TILED_COL_MAJOR
+
+  Going along k then walks A and B through consecutive tiles, and an A or B
+  tile is exactly what pack_A or pack_B makes of a TILED_NB x TILED_NB
+  block, so the macro kernel of packed_kernels.c runs on the tiles as they
+  are (kc = TILED_NB) and nothing is packed at compute time. Tile (I, J) of
+  C has entries above the diagonal only when I <= J, and only those tiles
+  are stored; the threads take them one at a time and macro_kernel() masks
+  the diagonal ones.
+
+  The micro-kernel comes from packed_select_isa(), so TRMM_ISA applies and
+  the distributed A and B have to be made for the same isa.
+
+  With lower_A set, A holds only its block packed lower triangle
+  (tiled_lower_from_col_major). Tile (I, P) of A is zero for P > I, so the k
+  loop of row I of tiles stops at P = I and the tiles past it are never read.
+*/
+
+#ifndef TILED_KERNELS_C
+#define TILED_KERNELS_C
+
+#include <omp.h>
+#include <string.h>
+
+#include "packed_kernels.c"
+#include "tiled_layout.c"
+
+static void tiled_trmm(const packed_isa *isa, int m0, int n0, const float *A, int lower_A, const float *B, float *C)
+{
+	int mt = tiled_count(m0);
+	int nt = tiled_count(n0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int t = 0; t < mt * nt; ++t)
+	{
+		// Column of tiles outermost, so neighbouring threads share B
+		int I = t % mt;
+		int J = t / mt;
+
+		if (I > J)
+			continue;
+
+		float *C_tile = &C[tiled_upper_offset(mt, I, J)];
+		memset(C_tile, 0, sizeof(float) * TILED_SIZE);
+
+		int P_end = lower_A ? I + 1 : mt;
+		for (int P = 0; P < P_end; ++P)
+		{
+			const float *A_tile = &A[lower_A ? tiled_lower_offset(I, P) : tiled_offset(1, mt, I, P)];
+			macro_kernel(isa, TILED_NB, TILED_NB, TILED_NB, I * TILED_NB, J * TILED_NB, A_tile,
+				     &B[tiled_offset(mt, 1, P, J)], C_tile, TILED_NB);
+		}
+	}
+}
+
+#endif // TILED_KERNELS_C
@@ -0,0 +1,240 @@
+/*
+  Tile-contiguous (block major) storage for the distributed matrices.
+
+  The matrix is cut into TILED_NB x TILED_NB tiles and each tile is one
+  contiguous block of TILED_SIZE floats. Edge tiles are padded with zeros to
+  the full size, so kernels never need an edge case for the k loop.
+
+  Like the element layouts of the variants, the tile layout is an (rs, cs)
+  pair counted in tiles: tile (I, J) starts at
+  (I * cs + J * rs) * TILED_SIZE. rs = 1, cs = mt (tile rows next to each
+  other) suits an A that is walked along its rows of tiles, rs = mt,
+  cs = 1 a B or C walked down its columns of tiles.
+
+  Inside a tile the elements are in one of three orders:
+
+  TILED_COL_MAJOR   column major with leading dimension TILED_NB
+  TILED_ROW_PANELS  panels of w rows, each stored column by column with its
+		    w values contiguous (the order of pack_A)
+  TILED_COL_PANELS  panels of w columns, each stored row by row with its w
+		    values contiguous (the order of pack_B)
+
+  A 96 x 96 tile is 36 KB, so a tile access touches nine consecutive pages
+  instead of one page per column at large m0. 96 is a multiple of every
+  register block of packed_kernels.c (32, 16 and 8 rows, 12 and 6 columns).
+
+  A lower triangular m x m matrix can also be kept block packed: only the
+  tiles (I, P) with P <= I are stored, row of tiles after row of tiles, so
+  tile (I, P) starts at (I * (I + 1) / 2 + P) * TILED_SIZE. The part of the
+  diagonal tiles above the diagonal is stored as zeros. That is
+  mt * (mt + 1) / 2 instead of mt * mt tiles, about half.
+
+  The strictly upper triangular output C of TRMM is kept the same way, by
+  columns of tiles: column J stores its tiles I <= J only (all mt of them
+  once J >= mt), so an m x n C needs about half of its mt * nt tiles when
+  n is close to m.
+*/
+
+#ifndef TILED_LAYOUT_C
+#define TILED_LAYOUT_C
+
+#include "trmm_alloc.c"
+#include <immintrin.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef TILED_NB
+#define TILED_NB 96
+#endif
+#define TILED_SIZE (TILED_NB * TILED_NB)
+
+#define TILED_COL_MAJOR 0
+#define TILED_ROW_PANELS 1
+#define TILED_COL_PANELS 2
+
+// Number of tiles needed to cover n rows or columns
+static inline int tiled_count(int n)
+{
+	return (n + TILED_NB - 1) / TILED_NB;
+}
+
+// Offset of tile (I, J) in floats
+static inline size_t tiled_offset(int rs, int cs, int I, int J)
+{
+	return ((size_t)I * cs + (size_t)J * rs) * TILED_SIZE;
+}
+
+// Floats needed for an m x n matrix in tiles
+static size_t tiled_size(int m, int n)
+{
+	return (size_t)tiled_count(m) * tiled_count(n) * TILED_SIZE;
+}
+
+// Offset of tile (I, P), P <= I, of a block packed lower triangle in floats
+static inline size_t tiled_lower_offset(int I, int P)
+{
+	return ((size_t)I * (I + 1) / 2 + P) * TILED_SIZE;
+}
+
+// Floats needed for the block packed lower triangle of an m x m matrix
+static size_t tiled_lower_size(int m)
+{
+	size_t mt = tiled_count(m);
+	return mt * (mt + 1) / 2 * TILED_SIZE;
+}
+
+// Offset of tile (I, J), I <= J, of a block packed upper triangle with mt
+// rows of tiles in floats
+static inline size_t tiled_upper_offset(int mt, int I, int J)
+{
+	size_t before = J <= mt ? (size_t)J * (J + 1) / 2 : (size_t)mt * (mt + 1) / 2 + (size_t)(J - mt) * mt;
+	return (before + I) * TILED_SIZE;
+}
+
+// Floats needed for the block packed upper triangle of an m x n matrix
+static size_t tiled_upper_size(int m, int n)
+{
+	return tiled_upper_offset(tiled_count(m), 0, tiled_count(n));
+}
+
+// size floats from trmm_alloc(), release with trmm_free()
+static float *tiled_alloc_floats(size_t size)
+{
+	return trmm_alloc(size);
+}
+
+static float *tiled_alloc(int m, int n)
+{
+	return tiled_alloc_floats(tiled_size(m, n));
+}
+
+// Position of element (r, c) inside a tile of the given order
+static inline int tiled_index(int r, int c, int order, int w)
+{
+	if (order == TILED_ROW_PANELS)
+		return (r / w) * w * TILED_NB + c * w + r % w;
+	if (order == TILED_COL_PANELS)
+		return (c / w) * w * TILED_NB + r * w + c % w;
+	return r + c * TILED_NB;
+}
+
+/*
+  The rows x cols block at src (leading dimension ld) into one tile in the
+  given order, zero padded to TILED_NB x TILED_NB. w is the panel size of
+  the panel orders and has to divide TILED_NB.
+*/
+static void tiled_pack_tile(int rows, int cols, const float *src, int ld, float *tile, int order, int w)
+{
+	if (order == TILED_ROW_PANELS)
+	{
+		for (int ir = 0; ir < TILED_NB; ir += w)
+			for (int jj = 0; jj < TILED_NB; ++jj)
+			{
+				int rr = 0;
+				if (jj < cols)
+					for (; rr < w && ir + rr < rows; ++rr)
+						tile[rr] = src[ir + rr + (size_t)jj * ld];
+				for (; rr < w; ++rr)
+					tile[rr] = 0.0f;
+				tile += w;
+			}
+	}
+	else if (order == TILED_COL_PANELS)
+	{
+		for (int jr = 0; jr < TILED_NB; jr += w)
+			for (int ii = 0; ii < TILED_NB; ++ii)
+			{
+				int cc = 0;
+				if (ii < rows)
+					for (; cc < w && jr + cc < cols; ++cc)
+						tile[cc] = src[ii + (size_t)(jr + cc) * ld];
+				for (; cc < w; ++cc)
+					tile[cc] = 0.0f;
+				tile += w;
+			}
+	}
+	else
+	{
+		for (int jj = 0; jj < cols; ++jj)
+		{
+			memcpy(&tile[jj * TILED_NB], &src[(size_t)jj * ld], sizeof(float) * rows);
+			memset(&tile[rows + jj * TILED_NB], 0, sizeof(float) * (TILED_NB - rows));
+		}
+		memset(&tile[cols * TILED_NB], 0, sizeof(float) * (TILED_NB - cols) * TILED_NB);
+	}
+}
+
+// m x n column major src (leading dimension ld) into tiles
+static void tiled_from_col_major(int m, int n, const float *src, int ld, float *dst, int rs, int cs, int order, int w)
+{
+	int mt = tiled_count(m);
+	int nt = tiled_count(n);
+
+#pragma omp parallel for collapse(2) schedule(static)
+	for (int J = 0; J < nt; ++J)
+		for (int I = 0; I < mt; ++I)
+		{
+			int i0 = I * TILED_NB;
+			int j0 = J * TILED_NB;
+			tiled_pack_tile(MIN(TILED_NB, m - i0), MIN(TILED_NB, n - j0), &src[i0 + (size_t)j0 * ld], ld,
+					&dst[tiled_offset(rs, cs, I, J)], order, w);
+		}
+}
+
+// Lower triangle of the m x m column major src into block packed tiles
+static void tiled_lower_from_col_major(int m, const float *src, int ld, float *dst, int order, int w)
+{
+	int mt = tiled_count(m);
+
+	// Row I of tiles holds I + 1 tiles
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int I = mt - 1; I >= 0; --I)
+		for (int P = 0; P <= I; ++P)
+		{
+			int i0 = I * TILED_NB;
+			int p0 = P * TILED_NB;
+			float *tile = &dst[tiled_lower_offset(I, P)];
+			tiled_pack_tile(MIN(TILED_NB, m - i0), MIN(TILED_NB, m - p0), &src[i0 + (size_t)p0 * ld], ld,
+					tile, order, w);
+
+			if (P == I)
+				for (int c = 1; c < TILED_NB; ++c)
+					for (int r = 0; r < c; ++r)
+						tile[tiled_index(r, c, order, w)] = 0.0f;
+		}
+}
+
+/*
+  Block packed upper triangle of TILED_COL_MAJOR tiles back into an m x n
+  column major dst. Only the strictly upper entries (i < j) are read from
+  the tiles, the rest of dst is set to zero.
+*/
+static void tiled_upper_to_col_major(int m, int n, const float *src, float *dst, int ld)
+{
+	int mt = tiled_count(m);
+
+#pragma omp parallel for schedule(static)
+	for (int j = 0; j < n; ++j)
+	{
+		int J = j / TILED_NB;
+		int jj = j % TILED_NB;
+		int i_end = MIN(j, m);
+		float *dst_col = &dst[(size_t)j * ld];
+
+		for (int I = 0; I <= J && I < mt; ++I)
+		{
+			int i0 = I * TILED_NB;
+			int rows = MIN(TILED_NB, i_end - i0);
+			if (rows > 0)
+				memcpy(&dst_col[i0], &src[tiled_upper_offset(mt, I, J) + jj * TILED_NB],
+				       sizeof(float) * rows);
+		}
+		memset(&dst_col[i_end], 0, sizeof(float) * (m - i_end));
+	}
+}
+
+#endif // TILED_LAYOUT_C
@@ -71,6 +71,14 @@ extern void DISTRIBUTED_FREE_NAME_TST( int m0, int n0,
 				       float *B_distributed,
 				       float *C_distributed );
 
+// Optional batched entry point, see time_batch_under_test()
+#ifdef COMPUTE_BATCH_NAME_TST
+extern void COMPUTE_BATCH_NAME_TST( int m0, int n0, int batch_count,
+				    float *A_batch,
+				    float *B_batch,
+				    float *C_batch ) __attribute__((weak));
+#endif
+
 extern void FUN_NAME_TST( int m, int n,
 			  float *src,
 			  int rs_s, int cs_s,
@@ -80,15 +88,15 @@ extern void FUN_NAME_TST( int m, int n,
 
 
 
-void fill_buffer_with_random( int num_elems, float *buff )
+void fill_buffer_with_random( long num_elems, float *buff )
 {
-    for(int i = 0; i < num_elems; ++i)
+    for(long i = 0; i < num_elems; ++i)
 	buff[i] = ((float)(rand()-((RAND_MAX)/2)))/((float)RAND_MAX);
 }
 
-void fill_buffer_with_value( int num_elems, float val, float *buff )
+void fill_buffer_with_value( long num_elems, float val, float *buff )
 {
-    for(int i = 0; i < num_elems; ++i)
+    for(long i = 0; i < num_elems; ++i)
 	buff[i] = val;
 }
 
@@ -217,6 +225,129 @@ void time_function_under_test(int num_trials,
 }
 
 
+/*
+  Batch mode: batch_count problems stored back to back (entry b at
+  A_batch + b*m0*m0, B_batch + b*m0*n0, C_batch + b*m0*n0) are run per
+  trial. Variants that define the batched entry point get the whole batch in
+  one call. The others change the layout of their buffers (padded leading
+  dimensions, tiles), so every entry is first allocated and distributed
+  through the variant's own DISTRIBUTED_ALLOCATE / DISTRIBUTE_DATA outside
+  the timed region, and only the COMPUTE calls on those buffers are timed.
+*/
+void time_batch_under_test(int num_trials,
+			   long *results, // results from each trial
+			   int m0, int n0,
+			   int batch_count,
+			   float *A_batch,
+			   float *B_batch,
+			   float *C_batch
+			   )
+{
+  int rid;
+  int num_ranks;
+  int root_rid = 0;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+  MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+  int batched = 0;
+#ifdef COMPUTE_BATCH_NAME_TST
+  batched = COMPUTE_BATCH_NAME_TST != NULL;
+#endif
+
+  // Distributed copies of every entry for the per problem calls
+  float **A_distributed = NULL;
+  float **B_distributed = NULL;
+  float **C_distributed = NULL;
+  if( !batched )
+    {
+      A_distributed = (float **)malloc(sizeof(float *)*batch_count);
+      B_distributed = (float **)malloc(sizeof(float *)*batch_count);
+      C_distributed = (float **)malloc(sizeof(float *)*batch_count);
+
+      for(int b = 0; b < batch_count; ++b )
+	{
+	  DISTRIBUTED_ALLOCATE_NAME_TST( m0, n0,
+					 &A_distributed[b],
+					 &B_distributed[b],
+					 &C_distributed[b] );
+
+	  DISTRIBUTE_DATA_NAME_TST( m0, n0,
+				    &A_batch[(long)b*m0*m0],
+				    &B_batch[(long)b*m0*n0],
+				    A_distributed[b],
+				    B_distributed[b] );
+	}
+    }
+
+  TIMER_INIT_COUNTERS(stop, start);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  TIMER_WARMUP(stop,start);
+
+  flush_cache();
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  for(int trial = 0; trial < num_trials; ++trial )
+    {
+      TIMER_GET_CLOCK(start);
+
+#ifdef COMPUTE_BATCH_NAME_TST
+      if( batched )
+	COMPUTE_BATCH_NAME_TST( m0, n0, batch_count,
+				A_batch,
+				B_batch,
+				C_batch );
+      else
+#endif
+	for(int b = 0; b < batch_count; ++b )
+	  COMPUTE_NAME_TST( m0, n0,
+			    A_distributed[b],
+			    B_distributed[b],
+			    C_distributed[b] );
+
+      TIMER_GET_CLOCK(stop);
+
+      TIMER_GET_DIFF(start,stop,results[trial]);
+
+      // Use the longest individual rank's runtime as the measured time.
+      long max_time;
+      MPI_Reduce(
+		 &results[trial],
+		 &max_time,
+		 1,
+		 MPI_LONG,
+		 MPI_MAX,
+		 root_rid,
+		 MPI_COMM_WORLD);
+
+      if( rid == root_rid )
+	{
+	  results[trial] = max_time;
+	}
+    }
+
+  if( !batched )
+    {
+      for(int b = 0; b < batch_count; ++b )
+	{
+	  COLLECT_DATA_NAME_TST( m0, n0,
+				 C_distributed[b],
+				 &C_batch[(long)b*m0*n0] );
+
+	  DISTRIBUTED_FREE_NAME_TST( m0, n0,
+				     A_distributed[b],
+				     B_distributed[b],
+				     C_distributed[b] );
+	}
+
+      free(A_distributed);
+      free(B_distributed);
+      free(C_distributed);
+    }
+}
+
+
 int scale_p_on_pos_ret_v_on_neg(int p, int v)
 {
   if (v < 1)
@@ -254,6 +385,9 @@ int main( int argc, char *argv[] )
   int in_m0;
   int in_n0;
 
+  // Problems per timed call, 0 times one problem at a time
+  int batch_count = 0;
+
   // Get command line arguments
   if(argc == 1 )
     {
@@ -268,7 +402,7 @@ int main( int argc, char *argv[] )
       // default to printing to stdout
       result_file = stdout;
     }
-  else if(argc == 5 + 1 || argc == 6 + 1 )
+  else if(argc == 5 + 1 || argc == 6 + 1 || argc == 7 + 1 )
     {
       min_size  = atoi(argv[1]);
       max_size  = atoi(argv[2]);
@@ -280,7 +414,10 @@ int main( int argc, char *argv[] )
       // default to printing to stdout
       result_file = stdout;
 
-      if(argc == 6 + 1)
+      if(argc == 7 + 1)
+	batch_count = atoi(argv[7]);
+
+      if(argc >= 6 + 1)
 	{
 	  // we don't want every node opening the same file
 	  // to write to.
@@ -296,7 +433,7 @@ int main( int argc, char *argv[] )
     }
   else
     {
-      printf("usage: %s min max step m0 n0 [filename]\n",
+      printf("usage: %s min max step m0 n0 [filename [batch_count]]\n",
 	     argv[0]);
       exit(1);
     }
@@ -320,6 +457,52 @@ int main( int argc, char *argv[] )
       int m0=scale_p_on_pos_ret_v_on_neg(p,in_m0);
       int n0=scale_p_on_pos_ret_v_on_neg(p,in_n0);
 
+      if( batch_count > 0 )
+	{
+	  // whole batches overflow int long before one problem does
+	  long A_batch_sz = (long)batch_count*m0*m0;
+	  long B_batch_sz = (long)batch_count*m0*n0;
+	  long C_batch_sz = (long)batch_count*m0*n0;
+
+	  float *A_batch = (float *)malloc(sizeof(float)*A_batch_sz);
+	  float *B_batch = (float *)malloc(sizeof(float)*B_batch_sz);
+	  float *C_batch = (float *)malloc(sizeof(float)*C_batch_sz);
+
+	  fill_buffer_with_random( A_batch_sz, A_batch );
+	  fill_buffer_with_random( B_batch_sz, B_batch );
+	  fill_buffer_with_value( C_batch_sz, -1, C_batch );
+
+	  long *results = (long *)malloc(sizeof(long)*num_trials);
+
+	  time_batch_under_test(num_trials,
+				results,
+				m0, n0,
+				batch_count,
+				A_batch,
+				B_batch,
+				C_batch);
+
+	  float nanoseconds = (float)pick_min_in_list(num_trials, results);
+
+	  // Same flop convention as below, for the whole batch
+	  long num_flops = (long)batch_count*m0*m0*n0;
+
+	  float throughput = num_flops / nanoseconds;
+
+	  if( rid == 0)
+	    {
+	      fprintf(result_file, "%i,%i,%i,%2.2f\n",
+		      num_ranks,
+		      m0,n0, throughput);
+	    }
+
+	  free(results);
+	  free(A_batch);
+	  free(B_batch);
+	  free(C_batch);
+	  continue;
+	}
+
       // How big of a buffer do we need
       int A_sequential_sz=m0*m0;
       int C_sequential_sz=m0*n0;
@@ -376,7 +559,7 @@ int main( int argc, char *argv[] )
       float nanoseconds = ((float)min_res)/(num_runs_per_trial);
 
       // Number of floating point operations
-      long num_flops = m0*m0*n0; // close enough
+      long num_flops = (long)m0*m0*n0; // close enough
 
       // This gives us throughput as GFLOP/s
       float throughput =  num_flops / nanoseconds;
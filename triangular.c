@@ -0,0 +1,31 @@
+/*
+  Structure of A the variants may rely on.
+
+  The header of every variant says A is lower triangular (A_{i,p} = 0 if
+  p > i), but the verifier and the timer fill all of A and the baseline reads
+  all of it. With TRMM_LOWER_A=1 the variants that support it trust the
+  documented structure instead: they may drop the upper triangle of A when
+  distributing it and never read it again. The result then only matches the
+  baseline if A really is lower triangular, which verify_op.c ensures when
+  the same variable is set.
+*/
+
+#ifndef TRIANGULAR_C
+#define TRIANGULAR_C
+
+#include <stdlib.h>
+
+// TRMM_LOWER_A read once
+static int trmm_lower_A(void)
+{
+	static int lower_A = -1;
+
+	if (lower_A < 0)
+	{
+		const char *text = getenv("TRMM_LOWER_A");
+		lower_A = text != NULL && atoi(text) > 0;
+	}
+	return lower_A;
+}
+
+#endif // TRIANGULAR_C
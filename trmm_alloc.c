@@ -0,0 +1,221 @@
+/*
+  Allocator for the distributed buffers.
+
+  malloc only promises 16 byte alignment and 4 KB pages, so at m0 = 8192
+  the three buffers are several hundred MB spread over ~10^5 pages and the
+  column walks of the kernels miss the TLB. trmm_alloc() maps the memory
+  itself instead:
+
+  - the data is 64 byte (cache line, AVX-512 register) aligned
+  - buffers of at least one huge page start on a 2 MB boundary and are
+    advised MADV_HUGEPAGE, so the kernel backs them with transparent huge
+    pages when THP is "always" or "madvise"
+  - with TRMM_HUGETLB=1 the buffer is taken from the hugetlbfs pool
+    (vm.nr_hugepages) first, falling back to the above if the pool is empty
+
+  trmm_alloc_kind() tells which of the three a buffer got. With
+  TRMM_ALLOC_REPORT=1 every allocation prints its size and kind to stderr.
+
+  The mapping length and kind are kept in a header of TRMM_ALLOC_ALIGN bytes
+  in front of the data, so trmm_free() needs only the pointer.
+
+  trmm_padded_ld() is the leading dimension the variants give their column
+  major distributed buffers. A column stride that is a multiple of 4 KB (m0
+  a multiple of 1024) puts row i of every column into the same L1 set, and
+  with L1 and L2 indexed by the low address bits a multiple of 1 KB already
+  crowds a few sets, so walking along a row of A or C or writing a block of
+  C columns evicts lines long before the cache is full. Such leading
+  dimensions get TRMM_LD_PAD floats (one cache line) more, which shifts
+  every column to the next set and keeps the 64 byte alignment of the
+  columns when m0 is a multiple of 16. TRMM_PAD_LD=0 turns it off.
+*/
+
+#ifndef TRMM_ALLOC_C
+#define TRMM_ALLOC_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// -std=c99 hides the Linux extensions of sys/mman.h, the values are ABI
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS 0x20
+#endif
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+int madvise(void *addr, size_t length, int advice);
+
+#define TRMM_ALLOC_ALIGN 64
+#define TRMM_HUGE_PAGE ((size_t)2 << 20)
+#define TRMM_SMALL_PAGE ((size_t)4 << 10)
+
+// Leading dimensions whose byte stride is a multiple of this get padded
+#ifndef TRMM_LD_ALIASING
+#define TRMM_LD_ALIASING 1024
+#endif
+#ifndef TRMM_LD_PAD
+#define TRMM_LD_PAD 16
+#endif
+
+#define TRMM_ALLOC_PLAIN 0
+#define TRMM_ALLOC_THP 1
+#define TRMM_ALLOC_HUGETLB 2
+
+typedef struct
+{
+	// Start and length of the whole mapping
+	void *base;
+	size_t length;
+	int kind;
+} trmm_alloc_header;
+
+static const char *trmm_alloc_kind_name(int kind)
+{
+	if (kind == TRMM_ALLOC_HUGETLB)
+		return "hugetlb";
+	if (kind == TRMM_ALLOC_THP)
+		return "thp";
+	return "4k";
+}
+
+static int trmm_alloc_env(const char *name)
+{
+	const char *text = getenv(name);
+	return text != NULL && atoi(text) > 0;
+}
+
+// Whether madvise(MADV_HUGEPAGE) has any effect, read once
+static int trmm_thp_enabled(void)
+{
+	static int enabled = -1;
+
+	if (enabled < 0)
+	{
+		char line[128] = "";
+		FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+		if (file != NULL)
+		{
+			if (fgets(line, sizeof(line), file) == NULL)
+				line[0] = '\0';
+			fclose(file);
+		}
+		enabled = strstr(line, "[always]") != NULL || strstr(line, "[madvise]") != NULL;
+	}
+	return enabled;
+}
+
+static size_t trmm_round_up(size_t value, size_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+// Mapping of at least length bytes starting on an alignment boundary
+static void *trmm_map_aligned(size_t length, size_t alignment)
+{
+	size_t mapped = length + alignment;
+	char *raw = (char *)mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == (char *)MAP_FAILED)
+		return NULL;
+
+	// Hand back the parts before and after the aligned range
+	char *base = (char *)trmm_round_up((uintptr_t)raw, alignment);
+	if (base > raw)
+		munmap(raw, base - raw);
+	if (raw + mapped > base + length)
+		munmap(base + length, raw + mapped - (base + length));
+	return base;
+}
+
+static trmm_alloc_header *trmm_alloc_header_of(const float *buffer)
+{
+	return (trmm_alloc_header *)((char *)buffer - TRMM_ALLOC_ALIGN);
+}
+
+// TRMM_ALLOC_PLAIN, TRMM_ALLOC_THP or TRMM_ALLOC_HUGETLB for a buffer of
+// trmm_alloc(). No variant checks the backing yet, TRMM_ALLOC_REPORT prints it.
+__attribute__((unused)) static int trmm_alloc_kind(const float *buffer)
+{
+	return trmm_alloc_header_of(buffer)->kind;
+}
+
+// count floats, 64 byte aligned, zero filled. NULL if out of memory.
+static float *trmm_alloc(size_t count)
+{
+	size_t bytes = TRMM_ALLOC_ALIGN + sizeof(float) * count;
+	void *base = NULL;
+	size_t length = 0;
+	int kind = TRMM_ALLOC_PLAIN;
+
+	if (bytes >= TRMM_HUGE_PAGE)
+	{
+		length = trmm_round_up(bytes, TRMM_HUGE_PAGE);
+		if (trmm_alloc_env("TRMM_HUGETLB"))
+		{
+			base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (base == MAP_FAILED)
+				base = NULL;
+			else
+				kind = TRMM_ALLOC_HUGETLB;
+		}
+		if (base == NULL)
+		{
+			base = trmm_map_aligned(length, TRMM_HUGE_PAGE);
+			if (base != NULL && trmm_thp_enabled() && madvise(base, length, MADV_HUGEPAGE) == 0)
+				kind = TRMM_ALLOC_THP;
+		}
+	}
+	else
+	{
+		length = trmm_round_up(bytes, TRMM_SMALL_PAGE);
+		base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED)
+			base = NULL;
+	}
+	if (base == NULL)
+		return NULL;
+
+	trmm_alloc_header *header = (trmm_alloc_header *)base;
+	header->base = base;
+	header->length = length;
+	header->kind = kind;
+
+	float *buffer = (float *)((char *)base + TRMM_ALLOC_ALIGN);
+	if (trmm_alloc_env("TRMM_ALLOC_REPORT"))
+		fprintf(stderr, "trmm_alloc: %zu KB %s\n", length >> 10, trmm_alloc_kind_name(kind));
+
+	return buffer;
+}
+
+static void trmm_free(float *buffer)
+{
+	if (buffer == NULL)
+		return;
+
+	trmm_alloc_header *header = trmm_alloc_header_of(buffer);
+	munmap(header->base, header->length);
+}
+
+// Leading dimension for a column major distributed buffer with m rows.
+// Not every variant that includes this file pads.
+__attribute__((unused)) static int trmm_padded_ld(int m)
+{
+	static int pad = -1;
+
+	if (pad < 0)
+	{
+		const char *text = getenv("TRMM_PAD_LD");
+		pad = text == NULL || atoi(text) > 0;
+	}
+	if (pad && m > 0 && sizeof(float) * m % TRMM_LD_ALIASING == 0)
+		return m + TRMM_LD_PAD;
+	return m;
+}
+
+#endif // TRMM_ALLOC_C
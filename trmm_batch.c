@@ -0,0 +1,242 @@
+/*
+  Batched TRMM for many small independent problems of the same shape.
+
+  trmm_batch()          A_array[b], B_array[b], C_array[b] point at entry b
+  trmm_batch_strided()  entry b starts at A + b * stride_A, B + b * stride_B
+			and C + b * stride_C
+
+  Each entry computes C = A * B restricted to i0 < j0 (C zeroed elsewhere)
+  with m0 x m0 A and m0 x n0 B and C, column major with leading dimension m0
+  like the variants.
+
+  The threads split the batch between them and every entry runs on a single
+  thread, so there is one fork/join per batch instead of one per problem.
+  For m0 = 8, 16, 24 and 32 on AVX2 machines the entries go through a kernel
+  specialized for that m0, with the p loop fully unrolled and a whole column
+  of C kept in registers. Other shapes run the packed engine with one thread.
+*/
+
+#include "packed_kernels.c"
+#include <immintrin.h>
+#include <omp.h>
+#include <stdlib.h>
+
+/*
+  C = A * B for one entry with m0 = 8 * V rows. Columns are done NB at a
+  time so NB * V accumulators hide the FMA latency without running out of
+  the 16 ymm registers. Rows i0 >= j0 are stored as zeros, so C needs no
+  separate zeroing. Only ever inlined into the
+  batch_small_<m0> functions below, where V is a constant and the loops
+  unroll completely.
+*/
+static inline __attribute__((always_inline, target("avx2,fma"))) void batch_small_kernel(int V, int n0, const float *A,
+											     const float *B, float *C)
+{
+	const int m0 = 8 * V;
+	const int NB = V <= 2 ? 4 : 6 - V;
+
+	const __m256i row_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	int j0 = 0;
+	for (; j0 + NB <= n0; j0 += NB)
+	{
+		__m256 c[4][4];
+
+#pragma GCC unroll 4
+		for (int jj = 0; jj < NB; ++jj)
+#pragma GCC unroll 4
+			for (int v = 0; v < V; ++v)
+				c[jj][v] = _mm256_setzero_ps();
+
+#pragma GCC unroll 32
+		for (int p0 = 0; p0 < m0; ++p0)
+		{
+#pragma GCC unroll 4
+			for (int v = 0; v < V; ++v)
+			{
+				__m256 a = _mm256_loadu_ps(&A[8 * v + p0 * m0]);
+#pragma GCC unroll 4
+				for (int jj = 0; jj < NB; ++jj)
+					c[jj][v] = _mm256_fmadd_ps(a, _mm256_broadcast_ss(&B[p0 + (j0 + jj) * m0]), c[jj][v]);
+			}
+		}
+
+#pragma GCC unroll 4
+		for (int jj = 0; jj < NB; ++jj)
+#pragma GCC unroll 4
+			for (int v = 0; v < V; ++v)
+			{
+				__m256i rows = _mm256_add_epi32(row_offsets, _mm256_set1_epi32(8 * v));
+				__m256 keep = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(j0 + jj), rows));
+				_mm256_storeu_ps(&C[8 * v + (j0 + jj) * m0], _mm256_and_ps(c[jj][v], keep));
+			}
+	}
+
+	// Leftover columns one at a time
+	for (; j0 < n0; ++j0)
+	{
+		__m256 c[4];
+
+#pragma GCC unroll 4
+		for (int v = 0; v < V; ++v)
+			c[v] = _mm256_setzero_ps();
+
+#pragma GCC unroll 32
+		for (int p0 = 0; p0 < m0; ++p0)
+		{
+			__m256 b = _mm256_broadcast_ss(&B[p0 + j0 * m0]);
+#pragma GCC unroll 4
+			for (int v = 0; v < V; ++v)
+				c[v] = _mm256_fmadd_ps(_mm256_loadu_ps(&A[8 * v + p0 * m0]), b, c[v]);
+		}
+
+#pragma GCC unroll 4
+		for (int v = 0; v < V; ++v)
+		{
+			__m256i rows = _mm256_add_epi32(row_offsets, _mm256_set1_epi32(8 * v));
+			__m256 keep = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(j0), rows));
+			_mm256_storeu_ps(&C[8 * v + j0 * m0], _mm256_and_ps(c[v], keep));
+		}
+	}
+}
+
+__attribute__((target("avx2,fma"))) static void batch_small_8(int n0, const float *A, const float *B, float *C)
+{
+	batch_small_kernel(1, n0, A, B, C);
+}
+
+__attribute__((target("avx2,fma"))) static void batch_small_16(int n0, const float *A, const float *B, float *C)
+{
+	batch_small_kernel(2, n0, A, B, C);
+}
+
+__attribute__((target("avx2,fma"))) static void batch_small_24(int n0, const float *A, const float *B, float *C)
+{
+	batch_small_kernel(3, n0, A, B, C);
+}
+
+__attribute__((target("avx2,fma"))) static void batch_small_32(int n0, const float *A, const float *B, float *C)
+{
+	batch_small_kernel(4, n0, A, B, C);
+}
+
+typedef void (*batch_small_fn)(int n0, const float *A, const float *B, float *C);
+
+// Unrolled kernel for m0, or NULL if there is none or the CPU lacks AVX2
+static batch_small_fn batch_small_select(int m0)
+{
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma"))
+		return NULL;
+
+	switch (m0)
+	{
+	case 8:
+		return batch_small_8;
+	case 16:
+		return batch_small_16;
+	case 24:
+		return batch_small_24;
+	case 32:
+		return batch_small_32;
+	default:
+		return NULL;
+	}
+}
+
+/*
+  Both forms describe their entries with a batch_layout: pointer arrays when
+  A_array is set, base pointers and strides otherwise.
+*/
+typedef struct
+{
+	const float *const *A_array;
+	const float *const *B_array;
+	float *const *C_array;
+	const float *A;
+	const float *B;
+	float *C;
+	long stride_A;
+	long stride_B;
+	long stride_C;
+} batch_layout;
+
+static inline void batch_entry(const batch_layout *layout, int b, const float **A, const float **B, float **C)
+{
+	if (layout->A_array != NULL)
+	{
+		*A = layout->A_array[b];
+		*B = layout->B_array[b];
+		*C = layout->C_array[b];
+	}
+	else
+	{
+		*A = &layout->A[b * layout->stride_A];
+		*B = &layout->B[b * layout->stride_B];
+		*C = &layout->C[b * layout->stride_C];
+	}
+}
+
+/*
+  The packed path gives every thread its own packing buffers and runs
+  packed_trmm with a single thread per entry, which then does not open a
+  nested parallel region.
+*/
+static void batch_run(int m0, int n0, int batch_count, const batch_layout *layout)
+{
+	batch_small_fn small = batch_small_select(m0);
+
+	if (small != NULL)
+	{
+#pragma omp parallel for schedule(static)
+		for (int b = 0; b < batch_count; ++b)
+		{
+			const float *A, *B;
+			float *C;
+			batch_entry(layout, b, &A, &B, &C);
+			small(n0, A, B, C);
+		}
+		return;
+	}
+
+	const packed_isa *isa = packed_select_isa();
+	packed_params params = packed_default_params(isa);
+	params.num_threads = 1;
+
+	// Small problems need far less than the cache sized buffers
+	params.mc = MIN(params.mc, m0);
+	params.kc = MIN(params.kc, m0);
+	params.nc = MIN(params.nc, n0);
+
+#pragma omp parallel
+	{
+		float *A_packed = (float *)_mm_malloc(sizeof(float) * packed_A_size(&params), PACKED_ALIGN);
+		float *B_packed = (float *)_mm_malloc(sizeof(float) * packed_B_size(&params), PACKED_ALIGN);
+
+#pragma omp for schedule(static)
+		for (int b = 0; b < batch_count; ++b)
+		{
+			const float *A, *B;
+			float *C;
+			batch_entry(layout, b, &A, &B, &C);
+			packed_trmm(isa, &params, m0, n0, A, B, C, A_packed, B_packed);
+		}
+
+		_mm_free(A_packed);
+		_mm_free(B_packed);
+	}
+}
+
+static void trmm_batch(int m0, int n0, int batch_count, const float *const *A_array, const float *const *B_array,
+		       float *const *C_array)
+{
+	batch_layout layout = {A_array, B_array, C_array, NULL, NULL, NULL, 0, 0, 0};
+	batch_run(m0, n0, batch_count, &layout);
+}
+
+static void trmm_batch_strided(int m0, int n0, int batch_count, const float *A, long stride_A, const float *B,
+			       long stride_B, float *C, long stride_C)
+{
+	batch_layout layout = {NULL, NULL, NULL, A, B, C, stride_A, stride_B, stride_C};
+	batch_run(m0, n0, batch_count, &layout);
+}
@@ -0,0 +1,315 @@
+/*
+  BLAS style strmm on top of the packed engine.
+
+  trmm_strmm(layout, side, uplo, trans, diag, m, n, alpha, A, lda, B, ldb, C, ldc)
+
+  side == TRMM_LEFT:   C = alpha * op(A) * B, A is m x m
+  side == TRMM_RIGHT:  C = alpha * B * op(A), A is n x n
+
+  B and C are m x n. op(A) is A or A^T (trans) and only the uplo triangle of
+  A is read; with diag == TRMM_UNIT its diagonal is taken to be 1 and not
+  read either. All three matrices can be views into larger ones (lda, ldb,
+  ldc >= their number of rows, or columns for TRMM_ROW_MAJOR). C is either
+  separate from B or, like in BLAS, B itself (C == B and ldc == ldb). In
+  place, each column of the result (side left) or row (side right) only
+  depends on the same column or row of B, so B is done in panels of
+  STRMM_INPLACE_PANEL columns or rows that go through a workspace and are
+  copied back once all of their reads are done. Other overlaps of B and C
+  are not supported.
+
+  Nothing is copied besides the packing the engine does anyway: the pack
+  routines below read through row and column strides, so row major storage
+  and op(A) = A^T only change the strides, and the triangle and unit
+  diagonal are applied while packing. Blocks of op(A) that are entirely
+  zero are skipped.
+
+  The flag values are the ones of CBLAS.
+*/
+
+#include "packed_kernels.c"
+#include <immintrin.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRMM_ROW_MAJOR 101
+#define TRMM_COL_MAJOR 102
+
+#define TRMM_NO_TRANS 111
+#define TRMM_TRANS 112
+
+#define TRMM_UPPER 121
+#define TRMM_LOWER 122
+
+#define TRMM_NON_UNIT 131
+#define TRMM_UNIT 132
+
+#define TRMM_LEFT 141
+#define TRMM_RIGHT 142
+
+/*
+  One operand of C = L * R as seen by the engine: element (i, j) is at
+  data[i * rs + j * cs]. A triangular operand (tri = TRMM_UPPER or
+  TRMM_LOWER) reads as zero outside its triangle and as 1 on the diagonal
+  when unit is set. Every element is multiplied by scale.
+*/
+typedef struct
+{
+	const float *data;
+	long rs;
+	long cs;
+	int tri;
+	int unit;
+	float scale;
+} strmm_operand;
+
+static inline float strmm_element(const strmm_operand *x, int i, int j)
+{
+	if ((x->tri == TRMM_LOWER && i < j) || (x->tri == TRMM_UPPER && i > j))
+		return 0.0f;
+	if (x->tri != 0 && x->unit && i == j)
+		return x->scale;
+	return x->scale * x->data[i * x->rs + j * x->cs];
+}
+
+// Rows [r0, r1) x columns [c0, c1) of x are all outside its triangle
+static int strmm_block_is_zero(const strmm_operand *x, int r0, int r1, int c0, int c1)
+{
+	if (x->tri == TRMM_LOWER)
+		return r1 - 1 < c0;
+	if (x->tri == TRMM_UPPER)
+		return r0 > c1 - 1;
+	return 0;
+}
+
+// Rows [r0, r1) x columns [c0, c1) of x are plain stored values: strictly
+// inside the triangle, column major and not scaled. pack_A/pack_B apply.
+static int strmm_block_is_plain(const strmm_operand *x, int r0, int r1, int c0, int c1)
+{
+	if (x->rs != 1 || x->scale != 1.0f)
+		return 0;
+	if (x->tri == TRMM_LOWER)
+		return r0 > c1 - 1;
+	if (x->tri == TRMM_UPPER)
+		return r1 - 1 < c0;
+	return 1;
+}
+
+// pack_A for rows [i0, i0 + mc) x columns [p0, p0 + kc) of x
+static void strmm_pack_left(int MR, int mc, int kc, const strmm_operand *x, int i0, int p0, float *A_packed)
+{
+	if (strmm_block_is_plain(x, i0, i0 + mc, p0, p0 + kc))
+	{
+		pack_A(MR, mc, kc, &x->data[i0 + p0 * x->cs], x->cs, A_packed);
+		return;
+	}
+
+	for (int ir = 0; ir < mc; ir += MR)
+	{
+		int mr = MIN(MR, mc - ir);
+		for (int pp = p0; pp < p0 + kc; ++pp)
+		{
+			int ii = 0;
+			for (; ii < mr; ++ii)
+				A_packed[ii] = strmm_element(x, i0 + ir + ii, pp);
+			for (; ii < MR; ++ii)
+				A_packed[ii] = 0.0f;
+			A_packed += MR;
+		}
+	}
+}
+
+// pack_B for rows [p0, p0 + kc) x columns [j0, j0 + nc) of x
+static void strmm_pack_right(int NR, int kc, int nc, const strmm_operand *x, int p0, int j0, float *B_packed)
+{
+	if (strmm_block_is_plain(x, p0, p0 + kc, j0, j0 + nc))
+	{
+		pack_B(NR, kc, nc, &x->data[p0 + j0 * x->cs], x->cs, B_packed);
+		return;
+	}
+
+	for (int jr = 0; jr < nc; jr += NR)
+	{
+		int nr = MIN(NR, nc - jr);
+		for (int pp = p0; pp < p0 + kc; ++pp)
+		{
+			int jj = 0;
+			for (; jj < nr; ++jj)
+				B_packed[jj] = strmm_element(x, pp, j0 + jr + jj);
+			for (; jj < NR; ++jj)
+				B_packed[jj] = 0.0f;
+			B_packed += NR;
+		}
+	}
+}
+
+/*
+  C(m x n) += L(m x k) * R(k x n) with the jc, pc, ic loops of packed_trmm
+  (PACKED_ORDER_JPI), skipping the blocks where L or R is zero.
+*/
+static void strmm_gemm(int m, int n, int k, const strmm_operand *L, const strmm_operand *R, float *C, int ldc)
+{
+	const packed_isa *isa = packed_select_isa();
+	packed_params params = packed_default_params(isa);
+
+	int MC = params.mc;
+	int KC = params.kc;
+	int NC = params.nc;
+	int NR = isa->nr;
+
+	float *A_packed = (float *)_mm_malloc(sizeof(float) * packed_A_size(&params), PACKED_ALIGN);
+	float *B_packed = (float *)_mm_malloc(sizeof(float) * packed_B_size(&params), PACKED_ALIGN);
+
+#pragma omp parallel num_threads(params.num_threads)
+	{
+		float *A_mine = &A_packed[(size_t)omp_get_thread_num() * (MC + PACKED_MR_MAX) * KC];
+
+		for (int jc = 0; jc < n; jc += NC)
+		{
+			int nc = MIN(NC, n - jc);
+			for (int pc = 0; pc < k; pc += KC)
+			{
+				int kc = MIN(KC, k - pc);
+				if (strmm_block_is_zero(R, pc, pc + kc, jc, jc + nc))
+					continue;
+
+#pragma omp for schedule(static)
+				for (int jr = 0; jr < nc; jr += NR)
+					strmm_pack_right(NR, kc, MIN(NR, nc - jr), R, pc, jc + jr, &B_packed[jr * kc]);
+
+#pragma omp for schedule(dynamic, 1)
+				for (int ic = 0; ic < m; ic += MC)
+				{
+					int mc = MIN(MC, m - ic);
+					if (strmm_block_is_zero(L, ic, ic + mc, pc, pc + kc))
+						continue;
+					strmm_pack_left(isa->mr, mc, kc, L, ic, pc, A_mine);
+					macro_kernel_gemm(isa, mc, nc, kc, A_mine, B_packed, &C[ic + jc * ldc], ldc);
+				}
+			}
+		}
+	}
+
+	_mm_free(A_packed);
+	_mm_free(B_packed);
+}
+
+// Width of the in place panels, see trmm_strmm()
+#define STRMM_INPLACE_PANEL 512
+
+/*
+  B = tri * B (side left) or B = B * tri (side right), where dense reads B,
+  panel by panel through one workspace.
+*/
+static void strmm_inplace(int side, int m, int n, const strmm_operand *tri, const strmm_operand *dense, float *B,
+			  int ldb)
+{
+	int panel = MIN(STRMM_INPLACE_PANEL, side == TRMM_LEFT ? n : m);
+	float *W = (float *)_mm_malloc(sizeof(float) * panel * (side == TRMM_LEFT ? m : n), PACKED_ALIGN);
+	if (W == NULL)
+	{
+		fprintf(stderr, "trmm_strmm: cannot allocate the in place workspace\n");
+		return;
+	}
+
+	strmm_operand part = *dense;
+
+	if (side == TRMM_LEFT)
+	{
+		for (int j0 = 0; j0 < n; j0 += panel)
+		{
+			int w = MIN(panel, n - j0);
+			part.data = &B[(long)j0 * ldb];
+
+			memset(W, 0, sizeof(float) * m * w);
+			strmm_gemm(m, w, m, tri, &part, W, m);
+
+			for (int jj = 0; jj < w; ++jj)
+				memcpy(&B[(long)(j0 + jj) * ldb], &W[(long)jj * m], sizeof(float) * m);
+		}
+	}
+	else
+	{
+		for (int i0 = 0; i0 < m; i0 += panel)
+		{
+			int h = MIN(panel, m - i0);
+			part.data = &B[i0];
+
+			memset(W, 0, sizeof(float) * h * n);
+			strmm_gemm(h, n, n, &part, tri, W, h);
+
+			for (int jj = 0; jj < n; ++jj)
+				memcpy(&B[i0 + (long)jj * ldb], &W[(long)jj * h], sizeof(float) * h);
+		}
+	}
+
+	_mm_free(W);
+}
+
+static void trmm_strmm(int layout, int side, int uplo, int trans, int diag, int m, int n, float alpha,
+		       const float *A, int lda, const float *B, int ldb, float *C, int ldc)
+{
+	if (m <= 0 || n <= 0)
+		return;
+
+	int in_place = C == B;
+	if (in_place && ldc != ldb)
+	{
+		fprintf(stderr, "trmm_strmm: in place needs ldc == ldb\n");
+		return;
+	}
+
+	/*
+	  Row major storage is the column major storage of the transpose:
+	  C^T = B^T op(A)^T, so swap m and n and the side. Reading A^T through
+	  the same memory also swaps which triangle is stored.
+	*/
+	if (layout == TRMM_ROW_MAJOR)
+	{
+		int tmp = m;
+		m = n;
+		n = tmp;
+		side = side == TRMM_LEFT ? TRMM_RIGHT : TRMM_LEFT;
+		uplo = uplo == TRMM_LOWER ? TRMM_UPPER : TRMM_LOWER;
+	}
+
+	// In place the panels overwrite B, which is still needed until then
+	if (!in_place || alpha == 0.0f)
+		for (int j0 = 0; j0 < n; ++j0)
+			memset(&C[(long)j0 * ldc], 0, sizeof(float) * m);
+	if (alpha == 0.0f)
+		return;
+
+	// op(A) = A^T reads A with the strides swapped, which turns its lower
+	// triangle into the upper one.
+	strmm_operand tri;
+	tri.data = A;
+	tri.rs = trans == TRMM_TRANS ? lda : 1;
+	tri.cs = trans == TRMM_TRANS ? 1 : lda;
+	tri.tri = trans == TRMM_TRANS ? (uplo == TRMM_LOWER ? TRMM_UPPER : TRMM_LOWER) : uplo;
+	tri.unit = diag == TRMM_UNIT;
+	tri.scale = 1.0f;
+
+	strmm_operand dense = {B, 1, ldb, 0, 0, 1.0f};
+
+	// alpha goes into whichever operand is the left one
+	if (in_place)
+	{
+		if (side == TRMM_LEFT)
+			tri.scale = alpha;
+		else
+			dense.scale = alpha;
+		strmm_inplace(side, m, n, &tri, &dense, C, ldc);
+	}
+	else if (side == TRMM_LEFT)
+	{
+		tri.scale = alpha;
+		strmm_gemm(m, n, m, &tri, &dense, C, ldc);
+	}
+	else
+	{
+		dense.scale = alpha;
+		strmm_gemm(m, n, n, &dense, &tri, C, ldc);
+	}
+}
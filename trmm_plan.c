@@ -0,0 +1,240 @@
+/*
+  Plan API for the packed engine.
+
+  trmm_plan_create() does everything that only depends on the shape once:
+  it queries the communicator, picks the micro-kernel, looks up the cache
+  blocks, loop order and thread count (the thread schedule) in the tuning
+  table and allocates the aligned packing buffers. trmm_execute() then only
+  packs and multiplies, so a stream of B matrices against the same A pays
+  the setup once.
+
+  trmm_plan *plan = trmm_plan_create(m0, n0, NULL);
+  for (...)
+	  trmm_execute(plan, A, B, C);
+  trmm_plan_destroy(plan);
+
+  With options.cache_A set the plan also keeps A packed in micro-panel order
+  and reuses it as long as the same A buffer comes back with the same version
+  tag, so those calls only pack B. trmm_execute() tags A with a generation
+  counter that trmm_plan_invalidate_A() bumps after A changed in place;
+  trmm_execute_versioned() takes the tag from the caller instead.
+
+  trmm_execute_inplace() overwrites B with the product instead of writing a
+  separate C, see packed_trmm_inplace(). Its workspace is allocated by the
+  first call.
+
+  Like the variants, only the root rank of the plan's communicator computes.
+  On the other ranks the plan holds no buffers and trmm_execute() returns
+  immediately.
+*/
+
+#include "packed_kernels.c"
+#include "packed_tuning.c"
+#include "triangular.c"
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	// Micro-kernel by name ("sse", "avx2", "avx512"), NULL for the fastest
+	// one the CPU supports (TRMM_ISA still applies then)
+	const char *isa;
+	// Threads per execute, 0 keeps the tuned or default count
+	int num_threads;
+	// Look the shape up in the tuning table, see packed_tuning.c
+	int use_tuning;
+	// Keep A packed between calls, see trmm_execute_versioned().
+	// Off unless TRMM_CACHE_A=1.
+	int cache_A;
+	// Trust that A is lower triangular, see triangular.c.
+	// Off unless TRMM_LOWER_A=1.
+	int lower_A;
+	MPI_Comm comm;
+	int root_rid;
+} trmm_options;
+
+typedef struct
+{
+	int m0;
+	int n0;
+
+	MPI_Comm comm;
+	int rid;
+	int num_ranks;
+	int root_rid;
+
+	const packed_isa *isa;
+	packed_params params;
+
+	// Packing buffers sized for params, NULL on the ranks that do not compute
+	float *A_packed;
+	float *B_packed;
+
+	// Packed copy of A_cached_source at version A_cached_version, NULL
+	// unless options.cache_A was set
+	float *A_cache;
+	const float *A_cached_source;
+	unsigned long A_cached_version;
+	int A_cache_valid;
+
+	// Version tag trmm_execute() uses
+	unsigned long A_generation;
+
+	// packed_inplace_size(m0, n0) floats, NULL until trmm_execute_inplace()
+	float *workspace;
+} trmm_plan;
+
+static trmm_options trmm_default_options(void)
+{
+	trmm_options options;
+	options.isa = NULL;
+	options.num_threads = 0;
+	options.use_tuning = 1;
+	options.cache_A = getenv("TRMM_CACHE_A") != NULL && atoi(getenv("TRMM_CACHE_A")) > 0;
+	options.lower_A = trmm_lower_A();
+	options.comm = MPI_COMM_WORLD;
+	options.root_rid = 0;
+	return options;
+}
+
+static void trmm_plan_destroy(trmm_plan *plan)
+{
+	if (plan == NULL)
+		return;
+
+	_mm_free(plan->A_packed);
+	_mm_free(plan->B_packed);
+	_mm_free(plan->A_cache);
+	_mm_free(plan->workspace);
+	free(plan);
+}
+
+// options may be NULL for trmm_default_options(). Returns NULL if the
+// buffers cannot be allocated.
+static trmm_plan *trmm_plan_create(int m0, int n0, const trmm_options *options)
+{
+	trmm_options defaults = trmm_default_options();
+	if (options == NULL)
+		options = &defaults;
+
+	trmm_plan *plan = (trmm_plan *)calloc(1, sizeof(trmm_plan));
+	if (plan == NULL)
+		return NULL;
+
+	plan->m0 = m0;
+	plan->n0 = n0;
+	plan->comm = options->comm;
+	plan->root_rid = options->root_rid;
+	MPI_Comm_rank(plan->comm, &plan->rid);
+	MPI_Comm_size(plan->comm, &plan->num_ranks);
+
+	if (plan->rid != plan->root_rid)
+		return plan;
+
+	plan->isa = NULL;
+	if (options->isa != NULL)
+	{
+		plan->isa = packed_isa_by_name(options->isa);
+		if (plan->isa == NULL || !packed_isa_supported(plan->isa))
+		{
+			fprintf(stderr, "trmm_plan_create: isa %s is %s, ignoring\n", options->isa,
+				plan->isa != NULL ? "not supported on this CPU" : "unknown");
+			plan->isa = NULL;
+		}
+	}
+	if (plan->isa == NULL)
+		plan->isa = packed_select_isa();
+
+	plan->params = options->use_tuning ? packed_tuned_params(plan->isa, m0, n0) : packed_default_params(plan->isa);
+	if (options->num_threads > 0)
+		plan->params.num_threads = options->num_threads;
+	plan->params.lower_A = options->lower_A;
+
+	size_t A_size = sizeof(float) * packed_A_size(&plan->params);
+	size_t B_size = sizeof(float) * packed_B_size(&plan->params);
+	plan->A_packed = (float *)_mm_malloc(A_size, PACKED_ALIGN);
+	plan->B_packed = (float *)_mm_malloc(B_size, PACKED_ALIGN);
+
+	size_t cache_size = 0;
+	if (options->cache_A)
+	{
+		// At least one float so an empty shape still gets a buffer
+		cache_size = sizeof(float) * (packed_A_cache_size(plan->isa, &plan->params, m0, n0) + 1);
+		plan->A_cache = (float *)_mm_malloc(cache_size, PACKED_ALIGN);
+	}
+	if (plan->A_packed == NULL || plan->B_packed == NULL || (options->cache_A && plan->A_cache == NULL))
+	{
+		trmm_plan_destroy(plan);
+		return NULL;
+	}
+
+	// Fault the pages in now instead of in the first execute
+	memset(plan->A_packed, 0, A_size);
+	memset(plan->B_packed, 0, B_size);
+	if (plan->A_cache != NULL)
+		memset(plan->A_cache, 0, cache_size);
+
+	return plan;
+}
+
+/*
+  C = A * B restricted to i0 < j0 for the shape of plan. If the plan caches
+  A and the last call packed this A buffer with the same A_version, the
+  packed copy is reused, otherwise A is packed into the cache first.
+*/
+static void trmm_execute_versioned(trmm_plan *plan, const float *A, unsigned long A_version, const float *B,
+				   float *C)
+{
+	if (plan->rid != plan->root_rid)
+		return;
+
+	if (plan->A_cache == NULL)
+	{
+		packed_trmm(plan->isa, &plan->params, plan->m0, plan->n0, A, B, C, plan->A_packed, plan->B_packed);
+		return;
+	}
+
+	if (!plan->A_cache_valid || plan->A_cached_source != A || plan->A_cached_version != A_version)
+	{
+		packed_pack_A_cache(plan->isa, &plan->params, plan->m0, plan->n0, A, plan->A_cache);
+		plan->A_cached_source = A;
+		plan->A_cached_version = A_version;
+		plan->A_cache_valid = 1;
+	}
+
+	packed_trmm_cached(plan->isa, &plan->params, plan->m0, plan->n0, A, plan->A_cache, B, C, plan->A_packed,
+			   plan->B_packed);
+}
+
+static void trmm_execute(trmm_plan *plan, const float *A, const float *B, float *C)
+{
+	trmm_execute_versioned(plan, A, plan->A_generation, B, C);
+}
+
+// A changed in place: the next trmm_execute() packs it again
+static void trmm_plan_invalidate_A(trmm_plan *plan)
+{
+	++plan->A_generation;
+}
+
+// B = A * B restricted to i0 < j0. Returns -1 if the workspace cannot be
+// allocated, B is untouched then.
+static int trmm_execute_inplace(trmm_plan *plan, const float *A, float *B)
+{
+	if (plan->rid != plan->root_rid)
+		return 0;
+
+	if (plan->workspace == NULL)
+	{
+		size_t size = sizeof(float) * (packed_inplace_size(plan->m0, plan->n0) + 1);
+		plan->workspace = (float *)_mm_malloc(size, PACKED_ALIGN);
+		if (plan->workspace == NULL)
+			return -1;
+	}
+
+	packed_trmm_inplace(plan->isa, &plan->params, plan->m0, plan->n0, A, B, plan->A_packed, plan->B_packed,
+			    plan->workspace);
+	return 0;
+}
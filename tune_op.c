@@ -0,0 +1,220 @@
+/*
+  Autotuner for the packed engine.
+
+  For every problem size in [min, max) (scaled the same way as timer_op.c)
+  it times packed_trmm over a grid of cache blocks (mc, kc, nc), loop orders
+  and thread counts with the micro-kernel packed_select_isa() picks, and
+  merges the fastest setting into the tuning file that packed_tuned_params()
+  reads at run time.
+
+  usage: run_tune_op.x min max step m0 n0 [tuning_file]
+
+  Entries for other shapes or other instruction sets already in the file are
+  kept, so the tuner can be run once per shape family, e.g. n0 = m0 and
+  n0 = 3.
+*/
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "packed_kernels.c"
+#include "packed_tuning.c"
+#include "timer.h"
+
+// Search space
+static const int tune_mc[] = {64, 128, 192, 256};
+static const int tune_kc[] = {128, 256, 384, 512};
+static const int tune_nc[] = {1020, 2040, 4080};
+static const int tune_order[] = {PACKED_ORDER_JPI, PACKED_ORDER_IPJ};
+
+#define TUNE_LEN(_a_) ((int)(sizeof(_a_) / sizeof((_a_)[0])))
+
+void fill_buffer_with_random( int num_elems, float *buff )
+{
+    for(int i = 0; i < num_elems; ++i)
+	buff[i] = ((float)(rand()-((RAND_MAX)/2)))/((float)RAND_MAX);
+}
+
+int scale_p_on_pos_ret_v_on_neg(int p, int v)
+{
+  if (v < 1)
+    return -1*v;
+  else
+    return v*p;
+}
+
+/*
+  Block sizes past the problem size all behave the same, so only the first
+  value of a sorted list that covers the whole dimension is worth timing.
+*/
+int is_redundant_block(const int *values, int index, int dim)
+{
+  return index > 0 && values[index - 1] >= dim;
+}
+
+// Best of num_trials runs in nanoseconds
+long time_params(const packed_isa *isa, const packed_params *params,
+		 int num_trials,
+		 int m0, int n0,
+		 float *A, float *B, float *C)
+{
+  float *A_packed = (float *)_mm_malloc(sizeof(float) * packed_A_size(params), PACKED_ALIGN);
+  float *B_packed = (float *)_mm_malloc(sizeof(float) * packed_B_size(params), PACKED_ALIGN);
+
+  TIMER_INIT_COUNTERS(stop, start);
+  TIMER_WARMUP(stop, start);
+
+  // Untimed run to fault in the buffers and wake up the threads
+  packed_trmm(isa, params, m0, n0, A, B, C, A_packed, B_packed);
+
+  long best = -1;
+  for( int trial = 0; trial < num_trials; ++trial )
+    {
+      long elapsed;
+
+      TIMER_GET_CLOCK(start);
+      packed_trmm(isa, params, m0, n0, A, B, C, A_packed, B_packed);
+      TIMER_GET_CLOCK(stop);
+      TIMER_GET_DIFF(start, stop, elapsed);
+
+      if( best < 0 || elapsed < best )
+	best = elapsed;
+    }
+
+  _mm_free(A_packed);
+  _mm_free(B_packed);
+
+  return best;
+}
+
+int main( int argc, char *argv[] )
+{
+  int rid;
+  int num_ranks;
+  int root_rid = 0;
+
+  MPI_Init(&argc,&argv);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+  MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+  int num_trials = 3;
+
+  // Problem parameters
+  int min_size;
+  int max_size;
+  int step_size;
+
+  int in_m0;
+  int in_n0;
+
+  const char *tuning_file = packed_tuning_file_name();
+
+  // Get command line arguments
+  if(argc == 5 + 1 || argc == 6 + 1 )
+    {
+      min_size  = atoi(argv[1]);
+      max_size  = atoi(argv[2]);
+      step_size = atoi(argv[3]);
+
+      in_m0=atoi(argv[4]);
+      in_n0=atoi(argv[5]);
+
+      if(argc == 6 + 1)
+	tuning_file = argv[6];
+    }
+  else
+    {
+      printf("usage: %s min max step m0 n0 [tuning_file]\n",
+	     argv[0]);
+      exit(1);
+    }
+
+  // The packed engine only runs on the root rank
+  if( rid == root_rid )
+    {
+      const packed_isa *isa = packed_select_isa();
+
+      packed_tuning_table *table = (packed_tuning_table *)malloc(sizeof(packed_tuning_table));
+      packed_tuning_load(tuning_file, table);
+
+      // Powers of two up to the number of OpenMP threads, plus that number
+      int max_threads = omp_get_max_threads();
+      int thread_counts[32];
+      int num_thread_counts = 0;
+      for( int t = 1; t < max_threads && num_thread_counts < 31; t *= 2 )
+	thread_counts[num_thread_counts++] = t;
+      thread_counts[num_thread_counts++] = max_threads;
+
+      printf("isa,m0,n0,mc,kc,nc,order,num_threads,result\n");
+
+      for( int p = min_size;
+	   p < max_size;
+	   p += step_size )
+	{
+	  int m0=scale_p_on_pos_ret_v_on_neg(p,in_m0);
+	  int n0=scale_p_on_pos_ret_v_on_neg(p,in_n0);
+
+	  float *A = (float *)malloc(sizeof(float)*m0*m0);
+	  float *B = (float *)malloc(sizeof(float)*m0*n0);
+	  float *C = (float *)malloc(sizeof(float)*m0*n0);
+
+	  fill_buffer_with_random( m0*m0, A );
+	  fill_buffer_with_random( m0*n0, B );
+
+	  // Start from the cache derived defaults so the table never picks worse
+	  packed_tuning_entry best;
+	  best.params = packed_default_params(isa);
+	  long best_time = time_params(isa, &best.params, num_trials, m0, n0, A, B, C);
+
+	  for( int t = 0; t < num_thread_counts; ++t )
+	    for( int o = 0; o < TUNE_LEN(tune_order); ++o )
+	      for( int a = 0; a < TUNE_LEN(tune_mc); ++a )
+		for( int k = 0; k < TUNE_LEN(tune_kc); ++k )
+		  for( int c = 0; c < TUNE_LEN(tune_nc); ++c )
+		    {
+		      if( is_redundant_block(tune_mc, a, m0) ||
+			  is_redundant_block(tune_kc, k, m0) ||
+			  is_redundant_block(tune_nc, c, n0) )
+			continue;
+
+		      packed_params params = {tune_mc[a], tune_kc[k], tune_nc[c], tune_order[o], thread_counts[t]};
+
+		      long elapsed = time_params(isa, &params, num_trials, m0, n0, A, B, C);
+
+		      if( best_time < 0 || elapsed < best_time )
+			{
+			  best_time = elapsed;
+			  best.params = params;
+			}
+		    }
+
+	  // Same flop count convention as timer_op.c
+	  long num_flops = (long)m0*m0*n0;
+
+	  snprintf(best.isa, sizeof(best.isa), "%s", isa->name);
+	  best.m0 = m0;
+	  best.n0 = n0;
+	  best.result = num_flops / ((float)best_time);
+
+	  packed_tuning_insert(table, &best);
+
+	  printf("%s,%i,%i,%i,%i,%i,%i,%i,%2.2f\n",
+		 best.isa, m0, n0,
+		 best.params.mc, best.params.kc, best.params.nc,
+		 best.params.order, best.params.num_threads,
+		 best.result);
+
+	  free(A);
+	  free(B);
+	  free(C);
+	}
+
+      packed_tuning_save(tuning_file, table);
+      free(table);
+    }
+  else
+    {/* all other nodes */}
+
+  MPI_Finalize();
+}
@@ -74,6 +74,15 @@ void printM256(__m256 vec)
 	printf("\n");
 }
 
+// Loading eight ints starting at tailMaskTable[8 - n] gives a lane mask with the
+// first n lanes set, for use with _mm256_maskload_ps and _mm256_maskstore_ps.
+static const int tailMaskTable[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static inline __m256i getTailMask(int n)
+{
+	return _mm256_loadu_si256((const __m256i *)&tailMaskTable[8 - n]);
+}
+
 inline void printWeights(const float *array)
 {
 	printf("Normal: ");
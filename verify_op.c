@@ -80,6 +80,14 @@ void fill_buffer_with_random( int num_elems, float *buff )
     }
 }
 
+// Zero A_{i,p} for p > i of an m x m column major matrix
+void zero_upper_triangle( int m, float *buff )
+{
+  for(int p = 1; p < m; ++p)
+    for(int i = 0; i < p; ++i)
+      buff[i + p*m] = 0.0f;
+}
+
 void fill_buffer_with_value( int num_elems, float val, float *buff )
 {
   for(int i = 0; i < num_elems; ++i)
@@ -144,6 +152,9 @@ int main( int argc, char *argv[] )
   int in_m0;
   int in_n0;
 
+  // TRMM_LOWER_A=1: make A really lower triangular
+  int lower_A = getenv("TRMM_LOWER_A") != NULL && atoi(getenv("TRMM_LOWER_A")) > 0;
+
   // Get command line arguments
   if(argc == 1 )
     {
@@ -233,6 +244,12 @@ int main( int argc, char *argv[] )
 
 	  // fill src_ref with random values
 	  fill_buffer_with_random( A_sequential_sz, A_sequential_ref );
+
+	  // Variants that trust the documented structure of A (see
+	  // triangular.c) are only correct for a lower triangular A.
+	  if( lower_A )
+	    zero_upper_triangle( m0, A_sequential_ref );
+
 	  fill_buffer_with_random( B_sequential_sz, B_sequential_ref );
 	  fill_buffer_with_value( C_sequential_sz, -1, C_sequential_ref );
 
@@ -0,0 +1,344 @@
+/*
+  Verifier for the BLAS style trmm_strmm() of trmm_blas.c.
+
+  For every problem size in [min, max) (scaled the same way as timer_op.c,
+  m = scaled m0, n = scaled n0) it runs trmm_strmm() for every combination of
+
+  layout    column major, row major
+  side      left, right
+  uplo      upper, lower
+  trans     A, A^T
+  diag      non unit, unit
+  in place  C separate from B, C == B
+  alpha     0.5, 0
+
+  and compares the result against a naive triple loop in double. A, B and C
+  are views into larger buffers: each starts one row and one column into
+  its parent and has a leading dimension a few elements larger than
+  needed, so the strides and offsets of the views are exercised as well.
+
+  Everything trmm_strmm() must not read (the parents around A and B, the
+  other triangle of A and its diagonal for unit) is NaN, so a stray read
+  shows up in the result. Everything it must not write (the parent around
+  C, and B when C is separate) is checked to be unchanged.
+
+  The error of an element is its difference from the reference over the
+  sum of the magnitudes of its terms, so cancellation does not fail it.
+
+  usage: run_verify_strmm_op.x min max step m0 n0 [result_file]
+*/
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trmm_blas.c"
+
+#define ERROR_THRESHOLD 1e-4
+
+// Extra elements in every leading dimension, odd so views are unaligned
+#define VERIFY_LD_PAD 3
+
+// Value of the cells around C, any write there changes it
+#define VERIFY_GUARD -12345.0f
+
+/*
+  An r x c matrix stored in layout inside a parent buffer: element (i, j)
+  is data[i + j * ld] for column major and data[i * ld + j] for row major.
+  The parent has one more row and column in front of the view and one
+  more behind it.
+*/
+typedef struct
+{
+  float *parent;
+  long parent_size;
+  float *data;
+  int rows;
+  int cols;
+  int ld;
+  int layout;
+} strmm_view;
+
+static long view_index(const strmm_view *v, int i, int j)
+{
+  if( v->layout == TRMM_COL_MAJOR )
+    return i + (long)j * v->ld;
+  return (long)i * v->ld + j;
+}
+
+static void view_create(strmm_view *v, int layout, int rows, int cols, int pad)
+{
+  // rows and columns as seen by the storage
+  int inner = layout == TRMM_COL_MAJOR ? rows : cols;
+  int outer = layout == TRMM_COL_MAJOR ? cols : rows;
+
+  v->layout = layout;
+  v->rows = rows;
+  v->cols = cols;
+  v->ld = inner + 2 + pad;
+  v->parent_size = (long)v->ld * (outer + 2);
+  v->parent = (float *)malloc(sizeof(float)*v->parent_size);
+  v->data = &v->parent[v->ld + 1];
+
+  for( long k = 0; k < v->parent_size; ++k )
+    v->parent[k] = NAN;
+}
+
+static void view_destroy(strmm_view *v)
+{
+  free(v->parent);
+}
+
+// 1 if parent element k is inside the view
+static int view_contains(const strmm_view *v, long k)
+{
+  long offset = k - (v->data - v->parent);
+  if( offset < 0 )
+    return 0;
+
+  long inner = offset % v->ld;
+  long outer = offset / v->ld;
+  if( v->layout == TRMM_COL_MAJOR )
+    return inner < v->rows && outer < v->cols;
+  return inner < v->cols && outer < v->rows;
+}
+
+static float random_value(void)
+{
+  return ((float)(rand()-((RAND_MAX)/2)))/((float)RAND_MAX);
+}
+
+// Stored element (r, c) of the triangular A is read by trmm_strmm
+static int triangle_is_read(int uplo, int diag, int r, int c)
+{
+  if( r == c )
+    return diag == TRMM_NON_UNIT;
+  return uplo == TRMM_LOWER ? r > c : r < c;
+}
+
+// Element (i, k) of op(A) as trmm_strmm defines it
+static double op_A(const strmm_view *A, int uplo, int trans, int diag, int i, int k)
+{
+  int r = trans == TRMM_TRANS ? k : i;
+  int c = trans == TRMM_TRANS ? i : k;
+
+  if( r == c && diag == TRMM_UNIT )
+    return 1.0;
+  if( uplo == TRMM_LOWER ? r < c : r > c )
+    return 0.0;
+  return A->data[view_index(A, r, c)];
+}
+
+/*
+  One call of trmm_strmm on fresh views. Returns the largest error, or
+  INFINITY if a cell that must stay untouched changed.
+*/
+static double verify_case(int layout, int side, int uplo, int trans, int diag, int in_place, float alpha,
+			  int m, int n)
+{
+  int k_dim = side == TRMM_LEFT ? m : n;
+
+  strmm_view A, B, C;
+  view_create(&A, layout, k_dim, k_dim, VERIFY_LD_PAD);
+  view_create(&B, layout, m, n, VERIFY_LD_PAD + 2);
+
+  for( int i = 0; i < k_dim; ++i )
+    for( int j = 0; j < k_dim; ++j )
+      if( triangle_is_read(uplo, diag, i, j) )
+	A.data[view_index(&A, i, j)] = random_value();
+  for( int i = 0; i < m; ++i )
+    for( int j = 0; j < n; ++j )
+      B.data[view_index(&B, i, j)] = random_value();
+
+  // Copy of B and its parent for the reference and the untouched check
+  float *B_before = (float *)malloc(sizeof(float)*B.parent_size);
+  memcpy(B_before, B.parent, sizeof(float)*B.parent_size);
+
+  if( in_place )
+    C = B;
+  else
+    {
+      view_create(&C, layout, m, n, VERIFY_LD_PAD + 4);
+      for( long k = 0; k < C.parent_size; ++k )
+	C.parent[k] = VERIFY_GUARD;
+    }
+
+  // The reference reads B through a view of the copy
+  strmm_view B_ref = B;
+  B_ref.parent = B_before;
+  B_ref.data = &B_before[B.data - B.parent];
+
+  trmm_strmm(layout, side, uplo, trans, diag, m, n, alpha,
+	     A.data, A.ld, B.data, B.ld, C.data, C.ld);
+
+  double max_error = 0.0;
+  for( int i = 0; i < m; ++i )
+    for( int j = 0; j < n; ++j )
+      {
+	double sum = 0.0;
+	double magnitude = 0.0;
+	for( int k = 0; k < k_dim; ++k )
+	  {
+	    double term = side == TRMM_LEFT ?
+	      op_A(&A, uplo, trans, diag, i, k) * B_ref.data[view_index(&B_ref, k, j)] :
+	      B_ref.data[view_index(&B_ref, i, k)] * op_A(&A, uplo, trans, diag, k, j);
+	    sum += term;
+	    magnitude += fabs(term);
+	  }
+	sum *= alpha;
+	magnitude *= fabs(alpha);
+
+	double diff = fabs(C.data[view_index(&C, i, j)] - sum);
+	double error = magnitude > 0.0 ? diff / magnitude : diff;
+	// NaN compares false, catch it explicitly
+	if( !(error <= max_error) )
+	  max_error = isnan(error) ? INFINITY : error;
+      }
+
+  // Nothing around C may change; without in place, nothing in B either
+  for( long k = 0; k < C.parent_size; ++k )
+    if( !view_contains(&C, k) )
+      {
+	float expected = in_place ? B_before[k] : VERIFY_GUARD;
+	if( memcmp(&C.parent[k], &expected, sizeof(float)) != 0 )
+	  max_error = INFINITY;
+      }
+  if( !in_place && memcmp(B.parent, B_before, sizeof(float)*B.parent_size) != 0 )
+    max_error = INFINITY;
+
+  free(B_before);
+  view_destroy(&A);
+  view_destroy(&B);
+  if( !in_place )
+    view_destroy(&C);
+
+  return max_error;
+}
+
+int scale_p_on_pos_ret_v_on_neg(int p, int v)
+{
+  if (v < 1)
+    return -1*v;
+  else
+    return v*p;
+}
+
+int main( int argc, char *argv[] )
+{
+  int rid;
+  int num_ranks;
+  int root_rid = 0;
+
+  MPI_Init(&argc,&argv);
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &rid);
+  MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+  // Problem parameters
+  int min_size;
+  int max_size;
+  int step_size;
+
+  int in_m0;
+  int in_n0;
+
+  FILE *result_file = NULL;
+
+  // Get command line arguments
+  if(argc == 5 + 1 || argc == 6 + 1 )
+    {
+      min_size  = atoi(argv[1]);
+      max_size  = atoi(argv[2]);
+      step_size = atoi(argv[3]);
+
+      in_m0=atoi(argv[4]);
+      in_n0=atoi(argv[5]);
+
+      if(argc == 6 + 1 && rid == root_rid)
+	{
+	  result_file = fopen(argv[6],"w");
+	  if(result_file == NULL)
+	    {
+	      printf("cannot open %s\n", argv[6]);
+	      exit(1);
+	    }
+	}
+    }
+  else
+    {
+      printf("usage: %s min max step m0 n0 [result_file]\n",
+	     argv[0]);
+      exit(1);
+    }
+
+  static const int layouts[] = {TRMM_COL_MAJOR, TRMM_ROW_MAJOR};
+  static const int sides[] = {TRMM_LEFT, TRMM_RIGHT};
+  static const int uplos[] = {TRMM_UPPER, TRMM_LOWER};
+  static const int transes[] = {TRMM_NO_TRANS, TRMM_TRANS};
+  static const int diags[] = {TRMM_NON_UNIT, TRMM_UNIT};
+  static const float alphas[] = {0.5f, 0.0f};
+
+  // Only the root rank computes, as in the variants
+  if( rid == root_rid )
+    {
+      int num_fails = 0;
+
+      const char *header = "m,n,layout,side,uplo,trans,diag,in_place,alpha,result\n";
+      printf("%s", header);
+      if(result_file != NULL)
+	fprintf(result_file, "%s", header);
+
+      for( int p = min_size;
+	   p < max_size;
+	   p += step_size )
+	{
+	  int m=scale_p_on_pos_ret_v_on_neg(p,in_m0);
+	  int n=scale_p_on_pos_ret_v_on_neg(p,in_n0);
+
+	  for( int l = 0; l < 2; ++l )
+	    for( int s = 0; s < 2; ++s )
+	      for( int u = 0; u < 2; ++u )
+		for( int t = 0; t < 2; ++t )
+		  for( int d = 0; d < 2; ++d )
+		    for( int in_place = 0; in_place < 2; ++in_place )
+		      for( int a = 0; a < 2; ++a )
+			{
+			  double error = verify_case(layouts[l], sides[s], uplos[u], transes[t], diags[d],
+						     in_place, alphas[a], m, n);
+
+			  char line[256];
+			  int length = snprintf(line, sizeof(line), "%i,%i,%s,%s,%s,%s,%s,%i,%g,",
+						m, n,
+						layouts[l] == TRMM_COL_MAJOR ? "col" : "row",
+						sides[s] == TRMM_LEFT ? "left" : "right",
+						uplos[u] == TRMM_UPPER ? "upper" : "lower",
+						transes[t] == TRMM_TRANS ? "T" : "N",
+						diags[d] == TRMM_UNIT ? "unit" : "non_unit",
+						in_place, alphas[a]);
+
+			  // if our error is greater than some threshold
+			  if( error > ERROR_THRESHOLD )
+			    {
+			      snprintf(line + length, sizeof(line) - length, "FAIL Max Diff: %g\n", error);
+			      ++num_fails;
+			    }
+			  else
+			    snprintf(line + length, sizeof(line) - length, "PASS\n");
+
+			  printf("%s", line);
+			  if(result_file != NULL)
+			    fprintf(result_file, "%s", line);
+			}
+	}
+
+      printf("Number of FAILS: %i\n", num_fails);
+    }
+  else
+    {/* all other nodes */}
+
+  if(result_file != NULL)
+    fclose(result_file);
+
+  MPI_Finalize();
+}
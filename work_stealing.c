@@ -0,0 +1,112 @@
+/*
+  Per-thread work-stealing deques of task ids (Chase-Lev).
+
+  All tasks are known before a parallel run starts: ws_seed() deals each
+  thread a contiguous slice of them, then every thread calls ws_next()
+  until it returns WS_EMPTY. ws_next() takes the thread's own tasks from
+  the bottom of its deque and, once that is empty, steals from the top of
+  the others, starting with the next thread. Owner and thieves only meet on
+  the last task of a deque, where a compare and swap on top decides.
+
+  Nothing is pushed during a run, so the deques are fixed slices of one
+  array and never grow.
+*/
+
+#ifndef WORK_STEALING_C
+#define WORK_STEALING_C
+
+#include <immintrin.h>
+#include <stdlib.h>
+
+#define WS_EMPTY -1
+#define WS_ABORT -2
+
+typedef struct
+{
+	const int *tasks;
+	long top;
+	// Own cache line, the owner writes bottom on every pop
+	char pad[64 - sizeof(const int *) - sizeof(long)];
+	long bottom;
+	char pad2[64 - sizeof(long)];
+} ws_deque;
+
+/*
+  Deal num_tasks task ids out to num_threads deques: thread t gets
+  tasks[first[t], first[t + 1]). tasks must stay alive for the run.
+*/
+static void ws_seed(ws_deque *queues, int num_threads, const int *tasks, const int *first)
+{
+	for (int t = 0; t < num_threads; ++t)
+	{
+		queues[t].tasks = &tasks[first[t]];
+		queues[t].top = 0;
+		queues[t].bottom = first[t + 1] - first[t];
+	}
+}
+
+// Owner end
+static int ws_pop(ws_deque *queue)
+{
+	long b = __atomic_load_n(&queue->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&queue->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	long t = __atomic_load_n(&queue->top, __ATOMIC_RELAXED);
+
+	if (t > b)
+	{
+		__atomic_store_n(&queue->bottom, b + 1, __ATOMIC_RELAXED);
+		return WS_EMPTY;
+	}
+
+	int task = queue->tasks[b];
+	if (t == b)
+	{
+		// Last task: race the thieves for it
+		if (!__atomic_compare_exchange_n(&queue->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			task = WS_EMPTY;
+		__atomic_store_n(&queue->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return task;
+}
+
+// Thief end, WS_ABORT if another thread got the task first
+static int ws_steal(ws_deque *queue)
+{
+	long t = __atomic_load_n(&queue->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	long b = __atomic_load_n(&queue->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return WS_EMPTY;
+
+	int task = queue->tasks[t];
+	if (!__atomic_compare_exchange_n(&queue->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return WS_ABORT;
+	return task;
+}
+
+// Next task for thread tid, WS_EMPTY once every deque is empty
+static int ws_next(ws_deque *queues, int num_threads, int tid)
+{
+	int task = ws_pop(&queues[tid]);
+	if (task != WS_EMPTY)
+		return task;
+
+	for (;;)
+	{
+		int contended = 0;
+		for (int k = 1; k < num_threads; ++k)
+		{
+			task = ws_steal(&queues[(tid + k) % num_threads]);
+			if (task >= 0)
+				return task;
+			contended |= task == WS_ABORT;
+		}
+		if (!contended)
+			return WS_EMPTY;
+		_mm_pause();
+	}
+}
+
+#endif // WORK_STEALING_C